@@ -0,0 +1,23 @@
+#-------------------------------------------------
+#
+# Top level project. Builds the engine library, the
+# headless tools and the viewer.
+#
+#-------------------------------------------------
+
+TEMPLATE = subdirs
+
+SUBDIRS = \
+        libbisect \
+        bisect_cli \
+        bisect_bench \
+        bisect_fuzz \
+        viewer
+
+viewer.file = bisect_opt.pro
+viewer.makefile = Makefile.viewer
+
+bisect_cli.depends = libbisect
+bisect_bench.depends = libbisect
+bisect_fuzz.depends = libbisect
+viewer.depends = libbisect
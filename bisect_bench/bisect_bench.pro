@@ -0,0 +1,18 @@
+#-------------------------------------------------
+#
+# Microbenchmarks of the bisection engine over the
+# transform families of the viewer. No Qt and no GL.
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = bisect_bench
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+include(../libbisect/libbisect.pri)
+
+SOURCES += \
+        main.cpp
@@ -0,0 +1,298 @@
+#include "bisectengine.h"
+#include "counters.h"
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+//
+// Microbenchmarks of the bisection engine. Every case maps a destination
+// image through one transform and runs InitPixels and
+// BisectAndVerifyPixels for each destination pixel on one thread, the
+// same work as a verification sweep. The cases are the transform families
+// of MyGLWidget::InitSrcPolygon, sweeps over the scale factor and the
+// angle, and rotations tilted by a perspective. Each case is run a few times to warm up, then timed over a
+// number of repetitions.
+//
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [-w width] [-h height] [-r repetitions] [-u warmup]\n"
+            "          [-t float|double|fixed] [-s] [-c case] [-J counters.json]\n"
+            "  -s  share the edges between neighbouring destination pixels\n"
+            "  -c  only run the cases whose name starts with case\n"
+            "  -J  write the hot path counters of all the cases, see counters.h\n",
+            name);
+}
+
+//
+// A transform family, M maps the source to the destination as in the
+// viewer. alpha is the animation parameter of the viewer, param the
+// scale factor or angle of the sweeps.
+//
+struct BenchCase {
+    char name[32];
+    int family;
+    float param;
+};
+
+#define FAMILY_SHEAR_SCALE   0
+#define FAMILY_AXIS_SHEAR    1
+#define FAMILY_INTERLEAVED   2
+#define FAMILY_PIXEL_CENTRE  3
+#define FAMILY_THREE_VERTEX  4
+#define FAMILY_GLITCH        5
+#define FAMILY_SCALE         6  // rotation of 17 degrees, uniform scale param
+#define FAMILY_ANGLE         7  // rotation of param degrees, scale 1/3 by 3
+#define FAMILY_KEYSTONE      8  // rotation of 17 degrees tilted by a perspective
+
+static glm::mat3 BenchTransform(const BenchCase *bc, float alpha)
+{
+    glm::mat3 M(1.0f);
+    float theta = 2.0*M_PI*alpha;
+    switch(bc->family){
+    case FAMILY_SHEAR_SCALE:
+        M = glm::translate(M,glm::vec2(0.0,alpha));
+        M = glm::shearX(M,1.0f);
+        M = glm::scale(M,glm::vec2(0.75f,1.1f));
+        break;
+    case FAMILY_AXIS_SHEAR:
+        M = glm::translate(M,glm::vec2(alpha,0.0f));
+        M = glm::shearY(M,1.0f);
+        M = glm::scale(M,glm::vec2(1.1f,0.75f));
+        break;
+    case FAMILY_INTERLEAVED:
+        M = glm::translate(M,glm::vec2(0.5,-0.5));
+        M = glm::rotate(M,theta);
+        M = glm::scale(M,glm::vec2(3.0,1.0));
+        M = glm::rotate(M,(float)M_PI/4.0f);
+        M = glm::scale(M,glm::vec2(0.5,0.5));
+        M = glm::translate(M,glm::vec2(-0.5,0.5));
+        break;
+    case FAMILY_PIXEL_CENTRE:
+        M = glm::translate(M,glm::vec2(0.5f,-0.5f));
+        M = glm::rotate(M,theta);
+        M = glm::translate(M,glm::vec2(-0.5f,0.5f));
+        break;
+    case FAMILY_THREE_VERTEX:
+        M = glm::translate(M, glm::vec2(0.25f,-0.5f));
+        M = glm::rotate(M,theta);
+        M = glm::scale(M,glm::vec2(0.5f,0.5f));
+        M = glm::translate(M, glm::vec2(-0.5f,0.5f));
+        break;
+    case FAMILY_GLITCH:{
+        float theta_glitch = 90.0;
+        theta_glitch *= M_PI/180.0;
+        M = glm::translate(M,glm::vec2(alpha,0.0));
+        M = glm::rotate(M, theta_glitch);
+        M = glm::scale(M,glm::vec2(1.0f/3.0f,3.0f));
+        M = glm::rotate(M,-theta_glitch);
+        break;
+    }
+    case FAMILY_SCALE:
+        M = glm::translate(M,glm::vec2(alpha,-alpha));
+        M = glm::rotate(M,17.0f*(float)M_PI/180.0f);
+        M = glm::scale(M,glm::vec2(bc->param,bc->param));
+        break;
+    case FAMILY_ANGLE:{
+        float theta_sweep = bc->param*(float)M_PI/180.0f;
+        M = glm::translate(M,glm::vec2(alpha,-alpha));
+        M = glm::rotate(M,theta_sweep);
+        M = glm::scale(M,glm::vec2(1.0f/3.0f,3.0f));
+        M = glm::rotate(M,-theta_sweep);
+        break;
+    }
+    case FAMILY_KEYSTONE:{
+        // w of the destination changes by param over 64 rows, every pixel
+        // is a quad of its own
+        glm::mat3 K(1.0f);
+        K[1][2] = bc->param/64.0f;
+        M = glm::translate(M,glm::vec2(alpha,-alpha));
+        M = glm::rotate(M,17.0f*(float)M_PI/180.0f);
+        M = K*M;
+        break;
+    }
+    }
+    return M;
+}
+
+static void BenchCasesInit(std::vector<BenchCase> &cases)
+{
+    const char *families[] = {
+        "shear_scale", "axis_shear", "interleaved",
+        "pixel_centre", "three_vertex", "glitch"
+    };
+    BenchCase bc;
+    for(int i=0;i<6;i++){
+        snprintf(bc.name,sizeof(bc.name),"%s",families[i]);
+        bc.family = i;
+        bc.param = 0.0f;
+        cases.push_back(bc);
+    }
+    // a scale below 1 is a downscale, the footprints grow as 1/scale^2
+    const float scales[] = {4.0f, 2.0f, 1.0f, 0.5f, 0.25f, 0.125f, 0.0625f};
+    for(float s : scales){
+        snprintf(bc.name,sizeof(bc.name),"scale_%g",s);
+        bc.family = FAMILY_SCALE;
+        bc.param = s;
+        cases.push_back(bc);
+    }
+    for(int a=0;a<=90;a+=15){
+        snprintf(bc.name,sizeof(bc.name),"angle_%d",a);
+        bc.family = FAMILY_ANGLE;
+        bc.param = (float)a;
+        cases.push_back(bc);
+    }
+    const float keystones[] = {0.5f, -0.5f};
+    for(float k : keystones){
+        snprintf(bc.name,sizeof(bc.name),"keystone_%g",k);
+        bc.family = FAMILY_KEYSTONE;
+        bc.param = k;
+        cases.push_back(bc);
+    }
+}
+
+//
+// timings of one case over the repetitions
+//
+struct BenchResult {
+    double mean;        // seconds per repetition
+    double stddev;
+    double min;
+    long long src_pixels;  // source pixels touched per repetition
+    size_t failed;
+};
+
+template<typename T>
+static void BenchRun(BisectEngineT<T> *engine, const BenchCase *bc, int width, int height,
+                     int warmup, int repetitions, BenchResult *result)
+{
+    // the translation of the families animates with alpha in the viewer,
+    // a fixed value off the pixel lattice keeps the runs comparable
+    float alpha = 0.37f;
+    glm::mat3 M_inv = TransformNormalize(glm::inverse(BenchTransform(bc,alpha)));
+    for(int i=0;i<warmup;i++){
+        engine->EmulateTransform(width,height,M_inv);
+    }
+    double sum = 0.0;
+    double sum2 = 0.0;
+    result->min = 0.0;
+    for(int i=0;i<repetitions;i++){
+        auto t_start = std::chrono::steady_clock::now();
+        engine->EmulateTransform(width,height,M_inv);
+        auto t_end = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(t_end - t_start).count();
+        sum += seconds;
+        sum2 += seconds*seconds;
+        if(i==0 || seconds<result->min) result->min = seconds;
+    }
+    result->mean = sum/repetitions;
+    double variance = sum2/repetitions - result->mean*result->mean;
+    result->stddev = variance>0.0 ? sqrt(variance) : 0.0;
+    result->src_pixels = 0;
+    for(int i=0;i<PIXEL_PATHS;i++){
+        result->src_pixels += engine->path_counts[i];
+    }
+    result->failed = engine->fail_vector.size();
+}
+
+template<typename T>
+static int Bench(int width, int height, int warmup, int repetitions, bool share_edges,
+                 const char *filter)
+{
+    std::vector<BenchCase> cases;
+    BenchCasesInit(cases);
+    BisectEngineT<T> *engine = new BisectEngineT<T>;
+    engine->share_edges = share_edges;
+    long pixels = (long)width*height;
+
+    printf("scalar:%s share_edges:%d pixels:%ld warmup:%d repetitions:%d\n",
+           ScalarTraits<T>::Name(), share_edges ? 1 : 0, pixels, warmup, repetitions);
+    printf("%-14s %10s %10s %8s %10s %10s %12s %6s\n",
+           "case", "ns/dst", "+-", "ns/src", "src/dst", "min ms", "Mpixels/s", "failed");
+    int failed = 0;
+    for(const BenchCase &bc : cases){
+        if(filter && strncmp(bc.name,filter,strlen(filter))){
+            continue;
+        }
+        BenchResult r;
+        BenchRun(engine,&bc,width,height,warmup,repetitions,&r);
+        double ns = r.mean*1e9;
+        printf("%-14s %10.1f %10.1f %8.2f %10.2f %10.3f %12.3f %6zu\n",
+               bc.name, ns/pixels, r.stddev*1e9/pixels,
+               r.src_pixels ? ns/r.src_pixels : 0.0,
+               (double)r.src_pixels/pixels, r.min*1e3,
+               pixels/r.mean*1e-6, r.failed);
+        if(r.failed) failed = 2;
+    }
+    delete engine;
+    return failed;
+}
+
+int main(int argc, char *argv[])
+{
+    int width = 64;
+    int height = 64;
+    int repetitions = 10;
+    int warmup = 2;
+    bool share_edges = false;
+    const char *scalar = "float";
+    const char *filter = NULL;
+    const char *counters_out = NULL;
+    int opt;
+    while((opt = getopt(argc, argv, "w:h:r:u:t:sc:J:")) != -1){
+        switch(opt){
+        case 'w':
+            width = atoi(optarg);
+            break;
+        case 'h':
+            height = atoi(optarg);
+            break;
+        case 'r':
+            repetitions = atoi(optarg);
+            break;
+        case 'u':
+            warmup = atoi(optarg);
+            break;
+        case 't':
+            scalar = optarg;
+            break;
+        case 's':
+            share_edges = true;
+            break;
+        case 'c':
+            filter = optarg;
+            break;
+        case 'J':
+            counters_out = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if(width<=0 || height<=0 || repetitions<=0 || warmup<0
+            || (strcmp(scalar,"float") && strcmp(scalar,"double") && strcmp(scalar,"fixed"))){
+        usage(argv[0]);
+        return 1;
+    }
+
+    int status;
+    if(!strcmp(scalar,"double")){
+        status = Bench<double>(width,height,warmup,repetitions,share_edges,filter);
+    }else if(!strcmp(scalar,"fixed")){
+        status = Bench<fixed32>(width,height,warmup,repetitions,share_edges,filter);
+    }else{
+        status = Bench<float>(width,height,warmup,repetitions,share_edges,filter);
+    }
+    if(counters_out){
+        BisectCounters counters;
+        BisectCountersTotal(&counters);
+        if(!BisectCountersWriteJSON(&counters,counters_out)) status = 1;
+    }
+    return status;
+}
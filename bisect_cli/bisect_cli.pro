@@ -0,0 +1,17 @@
+#-------------------------------------------------
+#
+# Headless verification sweeps. No Qt and no GL.
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = bisect_cli
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+include(../libbisect/libbisect.pri)
+
+SOURCES += \
+        main.cpp
@@ -0,0 +1,590 @@
+#include "bisectengine.h"
+#include "corpus.h"
+#include "counters.h"
+#include "emulate.h"
+#include "image.h"
+#include "phasetable.h"
+#include "resample.h"
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+//
+// Headless verification sweeps and resampling. Without -i runs
+// EmulateTransform over a destination image with the glitch transform used
+// by the viewer, or a rotation and scale given on the command line, tilted
+// by a perspective with -k. With -i and -o resamples a PGM/PPM image with
+// the same transform. With -R replays the failures recorded in a corpus.
+// With -C checks the resamplers against a flat source, and with -m the
+// streamed output against the one resampled in memory.
+//
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [-w width] [-h height] [-a angle_deg] [-x scale_x] [-y scale_y] [-k keystone]\n"
+            "          [-j threads] [-s] [-t float|double|fixed] [-i input.pnm -o output.pnm [-p phases]]\n"
+            "          [-m megabytes] [-A] [-P frames] [-W corpus] [-R corpus [-I index]]\n"
+            "          [-J counters.json] [-C]\n"
+            "  -x  scale along the rotated x axis, a negative scale mirrors, -y likewise\n"
+            "  -k  tilt the destination by a perspective, w runs from 1-k/2 to 1+k/2 up the image\n"
+            "  -s  share the edges between neighbouring destination pixels\n"
+            "  -t  scalar type of the clipping in verification sweeps, with -R the recorded one\n"
+            "  -p  resample through a table of phases x phases sub-pixel phases\n"
+            "  -m  resample in tiles from the mapped input, within this many megabytes\n"
+            "  -A  sum the covered source pixels of large footprints from row sums\n"
+            "  -P  build a plan of the weights once and apply it to this many frames\n"
+            "  -W  record the transform and the failures of the sweep in a corpus\n"
+            "  -R  replay all the records of a corpus, or only record -I\n"
+            "  -J  write the hot path counters of the run, see counters.h\n"
+            "  -C  check that a flat source comes out flat through every resampler,\n"
+            "      with -m that streaming gives the bytes of resampling in memory\n",
+            name);
+}
+
+#define SWEEP_LISTED_FAILURES 10
+
+//
+// verification sweep with the engine on scalar type T, returns 2 if any
+// destination pixel failed
+//
+template<typename T>
+static int Sweep(int width, int height, glm::mat3 &M_inv, int n_threads, bool share_edges,
+                 const char *corpus_out)
+{
+    long pixels = (long)width*height;
+    BisectEngineT<T> *engine = new BisectEngineT<T>;
+    engine->share_edges = share_edges;
+    auto t_start = std::chrono::steady_clock::now();
+    EmulateTransformParallel(engine,width,height,M_inv,n_threads);
+    auto t_end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(t_end - t_start).count();
+
+    // only the float rows run on the vector kernels
+    const char *simd = ScalarTraits<T>::Name()==ScalarTraits<float>::Name() ?
+                f2BisectSrcPolygonRowName() : "scalar";
+    printf("pixels:%ld failed:%zu threads:%d scalar:%s simd:%s time:%.3fs rate:%.0f pixels/s\n",
+           pixels, engine->fail_vector.size(), EmulateThreadCount(n_threads),
+           ScalarTraits<T>::Name(), simd, seconds, pixels/seconds);
+    printf("source pixels partial:%lld covered:%lld empty:%lld\n",
+           engine->path_counts[PIXEL_PARTIAL], engine->path_counts[PIXEL_COVERED],
+           engine->path_counts[PIXEL_EMPTY]);
+    // the engine does not print, the first failures are listed here
+    for(size_t i=0;i<engine->fail_pixels.size() && i<SWEEP_LISTED_FAILURES;i++){
+        printf("failed pixel:(%d,%d) area_error:%g\n",engine->fail_pixels[i].x,
+               engine->fail_pixels[i].y,engine->fail_errors[i]);
+    }
+    int failed = engine->fail_vector.empty() ? 0 : 2;
+    if(corpus_out){
+        CorpusBuilder builder;
+        CorpusBuilderAddSweep(&builder,engine,M_inv);
+        if(!CorpusBuilderWrite(&builder,corpus_out)) failed = 1;
+    }
+    delete engine;
+    return failed;
+}
+
+//
+// replays record `index` of a corpus, or all of them when index<0, with
+// the engine on scalar type T. Returns 2 if any record still fails.
+//
+template<typename T>
+static int Replay(const Corpus *corpus, const char *filename, long long index, int n_threads)
+{
+    if(index>=0 && (uint64_t)index>=corpus->n_records){
+        fprintf(stderr,"%s has %llu records\n",filename,(unsigned long long)corpus->n_records);
+        return 1;
+    }
+    int failed = 0;
+    if(index>=0){
+        const CorpusRecord *record = &corpus->records[index];
+        BisectEngineT<T> *engine = new BisectEngineT<T>;
+        bool ok = CorpusReplayRecord(engine,corpus,index);
+        printf("record:%lld transform:%u pixel:(%d,%d) src00:(%.9g,%.9g) recorded area_error:%g"
+               " scalar:%s grid:%dx%d area_error:%g %s\n",
+               index, record->transform, record->x, record->y, record->src00[0], record->src00[1],
+               record->area_error, ScalarTraits<T>::Name(), engine->Npixelx, engine->Npixely,
+               engine->area_error, ok ? "ok" : "failed");
+        delete engine;
+        failed = ok ? 0 : 2;
+    }else{
+        std::vector<uint64_t> still_failing;
+        auto t_start = std::chrono::steady_clock::now();
+        CorpusReplayParallel<T>(corpus,0,corpus->n_records,n_threads,&still_failing);
+        auto t_end = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(t_end - t_start).count();
+        printf("transforms:%llu records:%llu still failing:%zu threads:%d scalar:%s"
+               " time:%.3fs rate:%.0f records/s\n",
+               (unsigned long long)corpus->n_transforms, (unsigned long long)corpus->n_records,
+               still_failing.size(), EmulateThreadCount(n_threads), ScalarTraits<T>::Name(),
+               seconds, corpus->n_records/seconds);
+        failed = still_failing.empty() ? 0 : 2;
+    }
+    return failed;
+}
+
+//
+// The weights of every resampler have to add up to 1, so a flat source
+// comes out flat wherever the footprint lies inside the source. Resamples
+// a flat source of src_width by src_height through resample, -A, -P and,
+// with phases, the phase table, and counts the pixels that are off. A
+// pixel whose clipping lost area and is divided by the area of the
+// footprint comes out too dark. Returns 2 if any pixel is off.
+//
+#define CHECK_FLAT_VALUE 0.5f
+#define CHECK_FLAT_TOLERANCE 1e-4f
+
+// the footprint of destination pixel (x,y) lies inside the source, with a
+// pixel to spare for the conformed steps
+static bool CheckFootprintInside(glm::mat3 &M_inv, int x, int y, int src_width, int src_height)
+{
+    glm::dvec2 d2_corner;
+    for(int i=0;i<4;i++){
+        if(!d2project(M_inv,glm::dvec2(x + (i&1),-(y + (i>>1))),&d2_corner)) return false;
+        if(d2_corner.x<1.0 || d2_corner.x>src_width-1.0
+                || -d2_corner.y<1.0 || -d2_corner.y>src_height-1.0){
+            return false;
+        }
+    }
+    return true;
+}
+
+static int CheckFlat(int src_width, int src_height, int width, int height, glm::mat3 &M_inv,
+                     int phases)
+{
+    Image srcImage;
+    Image dstImage;
+    if(!ImageAlloc(&srcImage,src_width,src_height,1) || !ImageAlloc(&dstImage,width,height,1)){
+        fprintf(stderr,"unable to allocate the check images\n");
+        ImageFree(&srcImage);
+        ImageFree(&dstImage);
+        return 1;
+    }
+    for(size_t i=0;i<(size_t)src_width*src_height;i++){
+        srcImage.data[i] = CHECK_FLAT_VALUE;
+    }
+    RowSumTable table;
+    RowSumTableInit(&table,&srcImage);
+    const char *names[4] = {"resample","summed","plan","phases"};
+    int n_paths = phases ? 4 : 3;
+    int status = 0;
+    for(int path=0;path<n_paths;path++){
+        bool ok;
+        if(path==0){
+            ok = resample(&srcImage,&dstImage,M_inv);
+        }else if(path==1){
+            ok = resampleSummed(&srcImage,&table,&dstImage,M_inv);
+        }else if(path==2){
+            ResamplePlan plan;
+            ok = ResamplePlanInit(&plan,src_width,src_height,width,height,1,M_inv)
+                    && ResamplePlanApply(&plan,&srcImage,&dstImage);
+        }else{
+            PhaseTable pt;
+            ok = PhaseTableInit(&pt,M_inv,phases) && resamplePhase(&srcImage,&dstImage,M_inv,&pt);
+        }
+        if(!ok){
+            status = 1;
+            continue;
+        }
+        long checked = 0;
+        long off = 0;
+        float worst = 0.0f;
+        for(int y=0;y<height;y++){
+            for(int x=0;x<width;x++){
+                if(!CheckFootprintInside(M_inv,x,y,src_width,src_height)) continue;
+                checked++;
+                float error = (dstImage.data[(size_t)y*width + x] - CHECK_FLAT_VALUE)/CHECK_FLAT_VALUE;
+                if(fabsf(error)>CHECK_FLAT_TOLERANCE){
+                    off++;
+                    if(fabsf(error)>fabsf(worst)) worst = error;
+                }
+            }
+        }
+        printf("flat %s: pixels:%ld off:%ld worst:%g\n", names[path], checked, off, worst);
+        if(off && status==0) status = 2;
+    }
+    ImageFree(&srcImage);
+    ImageFree(&dstImage);
+    return status;
+}
+
+//
+// -m has to give the same bytes as resampling in memory. Writes a noise
+// source of src_width by src_height, streams it through ResampleStream
+// within stream_mb megabytes, with and without row sums, and compares the
+// files with those of resample and resampleSummed. Returns 2 if any byte
+// differs.
+//
+static bool CheckTempPath(char *path)
+{
+    int fd = mkstemp(path);
+    if(fd<0){
+        fprintf(stderr,"unable to create %s\n",path);
+        return false;
+    }
+    close(fd);
+    return true;
+}
+
+static int CheckStream(int src_width, int src_height, int width, int height, glm::mat3 &M_inv,
+                       int stream_mb)
+{
+    char src_path[] = "/tmp/bisect_check_src_XXXXXX";
+    char stream_path[] = "/tmp/bisect_check_stream_XXXXXX";
+    char memory_path[] = "/tmp/bisect_check_memory_XXXXXX";
+    if(!CheckTempPath(src_path)) return 1;
+    if(!CheckTempPath(stream_path) || !CheckTempPath(memory_path)){
+        unlink(src_path);
+        unlink(stream_path);
+        return 1;
+    }
+    Image srcImage;
+    Image dstImage;
+    Image streamImage;
+    Image memoryImage;
+    srcImage.data = dstImage.data = streamImage.data = memoryImage.data = NULL;
+    int status = 0;
+    if(!ImageAlloc(&srcImage,src_width,src_height,1) || !ImageAlloc(&dstImage,width,height,1)){
+        fprintf(stderr,"unable to allocate the check images\n");
+        status = 1;
+    }
+    if(status==0){
+        uint32_t seed = 1;
+        for(size_t i=0;i<(size_t)src_width*src_height;i++){
+            seed = seed*1664525u + 1013904223u;
+            srcImage.data[i] = (float)(seed>>24)/255.0f;
+        }
+        // the source in memory is read back, so it is the mapped one to the bit
+        bool written = ImageWritePNM(&srcImage,src_path);
+        ImageFree(&srcImage);
+        if(!written || !ImageReadPNM(&srcImage,src_path)) status = 1;
+    }
+    const char *names[2] = {"resample","summed"};
+    for(int path=0;path<2 && status!=1;path++){
+        bool summed = path==1;
+        ImageMap srcMap;
+        if(!ImageMapOpen(&srcMap,src_path)){
+            status = 1;
+            break;
+        }
+        bool ok = ResampleStream(&srcMap,stream_path,width,height,M_inv,(size_t)stream_mb<<20,summed);
+        ImageMapClose(&srcMap);
+        if(ok){
+            if(summed){
+                RowSumTable table;
+                RowSumTableInit(&table,&srcImage);
+                ok = resampleSummed(&srcImage,&table,&dstImage,M_inv);
+            }else{
+                ok = resample(&srcImage,&dstImage,M_inv);
+            }
+        }
+        ok = ok && ImageWritePNM(&dstImage,memory_path)
+                && ImageReadPNM(&streamImage,stream_path) && ImageReadPNM(&memoryImage,memory_path);
+        if(!ok){
+            status = 1;
+            break;
+        }
+        long differ = 0;
+        for(size_t i=0;i<(size_t)width*height;i++){
+            if(streamImage.data[i]!=memoryImage.data[i]) differ++;
+        }
+        printf("stream %s: pixels:%ld differ:%ld\n", names[path], (long)width*height, differ);
+        if(differ && status==0) status = 2;
+        ImageFree(&streamImage);
+        ImageFree(&memoryImage);
+    }
+    ImageFree(&srcImage);
+    ImageFree(&dstImage);
+    ImageFree(&streamImage);
+    ImageFree(&memoryImage);
+    unlink(src_path);
+    unlink(stream_path);
+    unlink(memory_path);
+    return status;
+}
+
+//
+// writes the counters of the run to counters_out if given, returns status
+// or 1 if they can not be written
+//
+static int CountersDone(const char *counters_out, int status)
+{
+    if(counters_out){
+        BisectCounters counters;
+        BisectCountersTotal(&counters);
+        if(!BisectCountersWriteJSON(&counters,counters_out)) return 1;
+    }
+    return status;
+}
+
+int main(int argc, char *argv[])
+{
+    int width = 0;
+    int height = 0;
+    float theta = 17.0f;
+    float scale_x = 1.0f/1.0001f;
+    float scale_y = 1.0001f;
+    float keystone = 0.0f;
+    const char *input = NULL;
+    const char *output = NULL;
+    int n_threads = 0;
+    bool share_edges = false;
+    const char *scalar = NULL;
+    int phases = 0;
+    const char *corpus_out = NULL;
+    const char *corpus_in = NULL;
+    long long corpus_index = -1;
+    int stream_mb = 0;
+    bool summed = false;
+    int frames = 0;
+    const char *counters_out = NULL;
+    bool check = false;
+    int opt;
+    while((opt = getopt(argc, argv, "w:h:a:x:y:k:j:st:p:i:o:m:AP:W:R:I:J:C")) != -1){
+        switch(opt){
+        case 'w':
+            width = atoi(optarg);
+            break;
+        case 'h':
+            height = atoi(optarg);
+            break;
+        case 'a':
+            theta = atof(optarg);
+            break;
+        case 'x':
+            scale_x = atof(optarg);
+            break;
+        case 'y':
+            scale_y = atof(optarg);
+            break;
+        case 'k':
+            keystone = atof(optarg);
+            break;
+        case 'j':
+            n_threads = atoi(optarg);
+            break;
+        case 's':
+            share_edges = true;
+            break;
+        case 't':
+            scalar = optarg;
+            break;
+        case 'p':
+            phases = atoi(optarg);
+            break;
+        case 'i':
+            input = optarg;
+            break;
+        case 'o':
+            output = optarg;
+            break;
+        case 'm':
+            stream_mb = atoi(optarg);
+            break;
+        case 'A':
+            summed = true;
+            break;
+        case 'P':
+            frames = atoi(optarg);
+            break;
+        case 'W':
+            corpus_out = optarg;
+            break;
+        case 'R':
+            corpus_in = optarg;
+            break;
+        case 'I':
+            corpus_index = atoll(optarg);
+            break;
+        case 'J':
+            counters_out = optarg;
+            break;
+        case 'C':
+            check = true;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if(width<0 || height<0 || scale_x==0.0f || scale_y==0.0f
+            || phases<0 || stream_mb<0 || frames<0
+            || keystone<=-2.0f || keystone>=2.0f || (keystone!=0.0f && (phases || stream_mb))
+            || (input==NULL)!=(output==NULL)
+            || (stream_mb && ((input==NULL && !check) || phases))
+            || (summed && (input==NULL || phases))
+            || (frames && (input==NULL || phases || stream_mb || summed))
+            || (corpus_index>=0 && corpus_in==NULL)
+            || (check && (input || summed || frames || corpus_in))
+            || (scalar && strcmp(scalar,"float") && strcmp(scalar,"double") && strcmp(scalar,"fixed"))){
+        usage(argv[0]);
+        return 1;
+    }
+
+    if(corpus_in){
+        Corpus corpus;
+        if(!CorpusOpen(&corpus,corpus_in)){
+            fprintf(stderr,"unable to open corpus %s\n",corpus_in);
+            return CountersDone(counters_out,1);
+        }
+        // the records replay on the scalar type they failed on unless -t says otherwise
+        if(!scalar) scalar = CorpusScalar(&corpus);
+        if(!scalar) scalar = "float";
+        int status;
+        if(!strcmp(scalar,"double")) status = Replay<double>(&corpus,corpus_in,corpus_index,n_threads);
+        else if(!strcmp(scalar,"fixed")) status = Replay<fixed32>(&corpus,corpus_in,corpus_index,n_threads);
+        else status = Replay<float>(&corpus,corpus_in,corpus_index,n_threads);
+        CorpusClose(&corpus);
+        return CountersDone(counters_out,status);
+    }
+    if(!scalar) scalar = "float";
+
+    Image srcImage;
+    ImageMap srcMap;
+    glm::vec2 A_src;
+    if(input){
+        // a streamed input is mapped, not read
+        if(stream_mb ? !ImageMapOpen(&srcMap,input) : !ImageReadPNM(&srcImage,input)){
+            return 1;
+        }
+        int src_width = stream_mb ? srcMap.width : srcImage.width;
+        int src_height = stream_mb ? srcMap.height : srcImage.height;
+        if(width==0) width = (int)(src_width*fabsf(scale_x) + 0.5f);
+        if(height==0) height = (int)(src_height*fabsf(scale_y) + 0.5f);
+        A_src = glm::vec2(src_width/2.0f,-src_height/2.0f);
+    }else{
+        if(width==0) width = 128;
+        if(height==0) height = 128;
+        A_src = glm::vec2((width-1)/2.0f,-(height-1)/2.0f);
+    }
+    glm::vec2 A_dst = input ? glm::vec2(width/2.0f,-height/2.0f) : A_src;
+
+    //
+    // scale along a rotated axis about the center of the image
+    //
+    theta *= M_PI/180.0;
+    glm::mat3 M = glm::translate(glm::mat3(1.0f),A_dst);
+    M = glm::rotate(M, theta);
+    M = glm::scale(M,glm::vec2(scale_x,scale_y));
+    M = glm::rotate(M,-theta);
+    M = glm::translate(M,-A_src);
+
+    //
+    // the keystone tilts the destination about its centre, the y of the
+    // centred destination scales w
+    //
+    if(keystone!=0.0f){
+        glm::mat3 K(1.0f);
+        K[1][2] = keystone/height;
+        M = glm::translate(glm::mat3(1.0f),A_dst)*K*glm::translate(glm::mat3(1.0f),-A_dst)*M;
+    }
+
+    glm::mat3 M_inv = TransformNormalize(glm::inverse(M));
+    long pixels = (long)width*height;
+
+    if(check){
+        int status = CheckFlat(width,height,width,height,M_inv,phases);
+        if(stream_mb && status!=1){
+            int stream_status = CheckStream(width,height,width,height,M_inv,stream_mb);
+            if(stream_status==1 || status==0) status = stream_status;
+        }
+        return CountersDone(counters_out,status);
+    }
+
+    if(input && stream_mb){
+        auto t_start = std::chrono::steady_clock::now();
+        bool ok = ResampleStream(&srcMap,output,width,height,M_inv,(size_t)stream_mb<<20,summed);
+        auto t_end = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(t_end - t_start).count();
+        if(ok){
+            printf("pixels:%ld time:%.3fs rate:%.0f pixels/s\n", pixels, seconds, pixels/seconds);
+        }
+        ImageMapClose(&srcMap);
+        return CountersDone(counters_out,ok ? 0 : 1);
+    }
+    if(input){
+        Image dstImage;
+        if(!ImageAlloc(&dstImage,width,height,srcImage.channels)){
+            fprintf(stderr,"unable to allocate the output image\n");
+            return 1;
+        }
+        PhaseTable *pt = NULL;
+        bool ok = true;
+        if(phases){
+            pt = new PhaseTable;
+            auto t_table = std::chrono::steady_clock::now();
+            ok = PhaseTableInit(pt,M_inv,phases);
+            double table_seconds = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - t_table).count();
+            if(ok){
+                printf("phases:%dx%d weights:%zu build:%.3fs area_error bound:%g measured:%g\n",
+                       phases, phases, pt->weights.size(), table_seconds,
+                       pt->area_error_bound, pt->area_error_max);
+            }
+        }
+        RowSumTable *table = NULL;
+        if(summed){
+            table = new RowSumTable;
+            auto t_table = std::chrono::steady_clock::now();
+            RowSumTableInit(table,&srcImage);
+            double table_seconds = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - t_table).count();
+            printf("row sums:%zu build:%.3fs\n", table->sums.size(), table_seconds);
+        }
+        ResamplePlan *plan = NULL;
+        if(frames){
+            plan = new ResamplePlan;
+            auto t_plan = std::chrono::steady_clock::now();
+            ok = ResamplePlanInit(plan,srcImage.width,srcImage.height,width,height,
+                                  srcImage.channels,M_inv);
+            double plan_seconds = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - t_plan).count();
+            if(ok){
+                printf("plan entries:%zu bytes:%zu build:%.3fs\n",
+                       plan->index.size(), ResamplePlanBytes(plan), plan_seconds);
+            }
+        }
+        auto t_start = std::chrono::steady_clock::now();
+        if(ok){
+            if(pt){
+                ok = resamplePhase(&srcImage,&dstImage,M_inv,pt);
+            }else if(summed){
+                ok = resampleSummed(&srcImage,table,&dstImage,M_inv);
+            }else if(plan){
+                // the frames are all the input, only the weights are timed
+                for(int f=0;f<frames && ok;f++){
+                    ok = ResamplePlanApply(plan,&srcImage,&dstImage);
+                }
+            }else{
+                ok = resample(&srcImage,&dstImage,M_inv);
+            }
+        }
+        auto t_end = std::chrono::steady_clock::now();
+        delete pt;
+        delete table;
+        delete plan;
+        double seconds = std::chrono::duration<double>(t_end - t_start).count();
+        // the time and rate of one frame
+        if(frames) seconds /= frames;
+        if(ok){
+            printf("pixels:%ld time:%.3fs rate:%.0f pixels/s\n", pixels, seconds, pixels/seconds);
+            ok = ImageWritePNM(&dstImage,output);
+        }
+        ImageFree(&dstImage);
+        ImageFree(&srcImage);
+        return CountersDone(counters_out,ok ? 0 : 1);
+    }
+
+    int status;
+    if(!strcmp(scalar,"double")){
+        status = Sweep<double>(width,height,M_inv,n_threads,share_edges,corpus_out);
+    }else if(!strcmp(scalar,"fixed")){
+        status = Sweep<fixed32>(width,height,M_inv,n_threads,share_edges,corpus_out);
+    }else{
+        status = Sweep<float>(width,height,M_inv,n_threads,share_edges,corpus_out);
+    }
+    return CountersDone(counters_out,status);
+}
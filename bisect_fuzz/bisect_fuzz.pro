@@ -0,0 +1,18 @@
+#-------------------------------------------------
+#
+# Randomized verification of area conservation
+# over all the cores. No Qt and no GL.
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = bisect_fuzz
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+include(../libbisect/libbisect.pri)
+
+SOURCES += \
+        main.cpp
@@ -0,0 +1,463 @@
+#include "bisectengine.h"
+#include "corpus.h"
+#include "counters.h"
+#include "emulate.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+//
+// Randomized verification of area conservation. Every case is one random
+// affine transform: a destination pixel is mapped onto a parallelogram in
+// the source, bisected over the source grid, and the areas of its pieces
+// have to add up to the area of the parallelogram (BisectAndVerifyPixels).
+// With -p every case is tilted by a random perspective as well, and the
+// footprint is a general convex quad. Half the cases are mirrored. The
+// cases are spread over all the cores. A case is generated from its own
+// 64 bit seed only, so any case reported can be replayed with -r, and the
+// failures can be recorded in a corpus for bisect_cli -R.
+//
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [-n cases] [-S seed] [-j threads] [-m max_extent] [-k worst]\n"
+            "          [-t float|double|fixed] [-p] [-r case_seed] [-W corpus] [-J counters.json]\n"
+            "  -n  number of random transforms, 1000000 by default\n"
+            "  -S  seed of the run, the case seeds are derived from it\n"
+            "  -m  longest edge of a footprint in source pixels, 16 by default\n"
+            "  -k  number of worst cases to list\n"
+            "  -p  tilt every case by a perspective, the seeds of -r need it too\n"
+            "  -r  replay the single case with this seed and print its footprint\n"
+            "  -W  record the failed cases in a corpus\n"
+            "  -J  write the hot path counters of the run, see counters.h\n",
+            name);
+}
+
+//
+// splitmix64, the same sequence on every platform unlike the
+// distributions of <random>
+//
+static uint64_t FuzzNext(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z>>30))*0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z>>27))*0x94d049bb133111ebull;
+    return z ^ (z>>31);
+}
+
+// uniform in [0,1)
+static float FuzzUniform(uint64_t *state)
+{
+    return (float)(FuzzNext(state)>>40)*(1.0f/16777216.0f);
+}
+
+// log uniform in [lo,hi)
+static float FuzzLogUniform(uint64_t *state, float lo, float hi)
+{
+    return lo*powf(hi/lo,FuzzUniform(state));
+}
+
+//
+// the kinds of transforms, the near degenerate ones are drawn as often as
+// the general one since that is where the failures are
+//
+#define FUZZ_GENERAL      0  // rotation, anisotropic scale, shear
+#define FUZZ_NEAR_AXIS    1  // edges just steeper than v2conform_axis snaps
+#define FUZZ_THIN         2  // one edge much shorter than the other
+#define FUZZ_NEAR_PARALLEL 3 // the two edges close to parallel
+#define FUZZ_LATTICE      4  // translation on the lattice or halfway
+#define FUZZ_KINDS        5
+
+static const char *fuzz_kind_names[FUZZ_KINDS] = {
+    "general", "near_axis", "thin", "near_parallel", "lattice"
+};
+
+struct FuzzCase {
+    uint64_t seed;
+    int kind;
+    bool mirrored;
+    glm::mat3 M_inv;  // destination to source
+};
+
+static void FuzzCaseInit(FuzzCase *fc, uint64_t seed, float max_extent, bool perspective)
+{
+    uint64_t state = seed;
+    fc->seed = seed;
+    fc->kind = (int)(FuzzNext(&state)%FUZZ_KINDS);
+    float theta = 2.0f*(float)M_PI*FuzzUniform(&state);
+    float scale_x = FuzzLogUniform(&state,1.0f/8.0f,max_extent);
+    float scale_y = FuzzLogUniform(&state,1.0f/8.0f,max_extent);
+    float shear = 2.0f*FuzzUniform(&state) - 1.0f;
+    glm::vec2 translate(256.0f*FuzzUniform(&state),-256.0f*FuzzUniform(&state));
+    switch(fc->kind){
+    case FUZZ_NEAR_AXIS:{
+        // tan theta from 1e-3 to 1e-2 off a multiple of 90 degrees
+        float tan_theta = FuzzLogUniform(&state,1.0001e-3f,1e-2f);
+        int quadrant = (int)(FuzzNext(&state)%4);
+        float sign = (FuzzNext(&state)&1) ? 1.0f : -1.0f;
+        theta = quadrant*0.5f*(float)M_PI + sign*atanf(tan_theta);
+        shear = 0.0f;
+        break;
+    }
+    case FUZZ_THIN:
+        scale_y = scale_x*FuzzLogUniform(&state,1e-3f,1e-1f);
+        break;
+    case FUZZ_NEAR_PARALLEL:
+        // shear of the unit square close to folding it flat
+        shear = (FuzzNext(&state)&1) ? 1.0f : -1.0f;
+        shear *= FuzzLogUniform(&state,10.0f,100.0f);
+        scale_y /= fabsf(shear);
+        break;
+    case FUZZ_LATTICE:
+        translate = glm::floor(translate) + 0.5f*(float)(FuzzNext(&state)%2);
+        break;
+    }
+    fc->M_inv = glm::translate(glm::mat3(1.0f),translate);
+    fc->M_inv = glm::rotate(fc->M_inv,theta);
+    fc->M_inv = glm::shearX(fc->M_inv,shear);
+    fc->M_inv = glm::scale(fc->M_inv,glm::vec2(scale_x,scale_y));
+    if(perspective){
+        // drawn after the affine part so that it stays the same. The tilt
+        // is applied in the destination, pixel (0,0) keeps its top left
+        // corner and w stays above 0.1 on the others, so the footprint
+        // grows by at most 10 times.
+        glm::mat3 P(1.0f);
+        for(int i=0;i<2;i++){
+            float sign = (FuzzNext(&state)&1) ? 1.0f : -1.0f;
+            P[i][2] = sign*FuzzLogUniform(&state,1e-3f,0.45f);
+        }
+        fc->M_inv = fc->M_inv*P;
+    }
+    // half the cases mirror the destination, drawn last so that the rest
+    // of the case does not change with it
+    fc->mirrored = (FuzzNext(&state)&1)!=0;
+    if(fc->mirrored){
+        fc->M_inv = glm::scale(fc->M_inv,glm::vec2(-1.0f,1.0f));
+    }
+}
+
+//
+// bisects the footprint of destination pixel (0,0), returns false if the
+// areas do not add up
+//
+template<typename T>
+static bool FuzzCaseRun(BisectEngineT<T> *engine, FuzzCase *fc)
+{
+    engine->InitTransform(fc->M_inv);
+    if(TransformProjective(fc->M_inv)){
+        engine->InitQuad(fc->M_inv,0,0);
+    }else{
+        glm::vec2 v2_src00(fc->M_inv*glm::vec3(0.0f,0.0f,1.0f));
+        engine->InitPolygon(v2_src00,engine->v2_dsrcx,engine->v2_dsrcy);
+    }
+    engine->InitPixels();
+    return engine->BisectAndVerifyPixels();
+}
+
+//
+// |area_error| in decades from 1e-9 to 1e-1, bin 0 is exact
+//
+#define FUZZ_BINS 11
+
+static int FuzzBin(float error)
+{
+    if(error==0.0f) return 0;
+    int bin = (int)floorf(log10f(error)) + 10;
+    return std::min(std::max(bin,1),FUZZ_BINS-1);
+}
+
+struct FuzzResult {
+    float error;  // |area_error|
+    float area_error;
+    long long index;
+    FuzzCase fc;
+};
+
+static bool FuzzWorse(const FuzzResult &a, const FuzzResult &b)
+{
+    if(a.error!=b.error) return a.error>b.error;
+    return a.fc.seed<b.fc.seed;
+}
+
+//
+// what a worker found in the cases it ran
+//
+struct FuzzStats {
+    long long histogram[FUZZ_BINS];
+    long long failed[FUZZ_KINDS];
+    long long cases[FUZZ_KINDS];
+    std::vector<FuzzResult> worst;  // sorted, at most n_worst
+    std::vector<FuzzResult> failures;  // in the order of the cases when recorded
+};
+
+static void FuzzStatsInit(FuzzStats *fs)
+{
+    memset(fs->histogram,0,sizeof(fs->histogram));
+    memset(fs->failed,0,sizeof(fs->failed));
+    memset(fs->cases,0,sizeof(fs->cases));
+    fs->worst.clear();
+    fs->failures.clear();
+}
+
+static void FuzzStatsAddWorst(FuzzStats *fs, const FuzzResult &r, int n_worst)
+{
+    if(n_worst==0 || ((int)fs->worst.size()==n_worst && !FuzzWorse(r,fs->worst.back()))){
+        return;
+    }
+    fs->worst.insert(std::upper_bound(fs->worst.begin(),fs->worst.end(),r,FuzzWorse),r);
+    if((int)fs->worst.size()>n_worst) fs->worst.pop_back();
+}
+
+//
+// the footprint of destination pixel (0,0) as FuzzCaseRun sets it up. The
+// steps of a perspective case are the sides of its quad from v2_src00.
+//
+static void FuzzFootprint(const FuzzCase *fc, glm::vec2 *v2_src00, glm::vec2 *v2_dsrcx, glm::vec2 *v2_dsrcy)
+{
+    if(TransformProjective(fc->M_inv)){
+        glm::dvec2 d2_corners[3];
+        d2project(fc->M_inv,glm::dvec2(0.0,0.0),&d2_corners[0]);
+        d2project(fc->M_inv,glm::dvec2(1.0,0.0),&d2_corners[1]);
+        d2project(fc->M_inv,glm::dvec2(0.0,-1.0),&d2_corners[2]);
+        *v2_src00 = glm::vec2(d2_corners[0]);
+        *v2_dsrcx = glm::vec2(d2_corners[1] - d2_corners[0]);
+        *v2_dsrcy = glm::vec2(d2_corners[2] - d2_corners[0]);
+        return;
+    }
+    *v2_src00 = glm::vec2(fc->M_inv*glm::vec3(0.0f,0.0f,1.0f));
+    *v2_dsrcx = v2conform_axis(glm::vec2(fc->M_inv*glm::vec3(1.0f,0.0f,0.0f)));
+    *v2_dsrcy = v2conform_axis(glm::vec2(fc->M_inv*glm::vec3(0.0f,-1.0f,0.0f)));
+}
+
+static void FuzzPrintCase(const FuzzCase *fc)
+{
+    glm::vec2 v2_src00, v2_dsrcx, v2_dsrcy;
+    FuzzFootprint(fc,&v2_src00,&v2_dsrcx,&v2_dsrcy);
+    printf("seed:0x%016" PRIx64 " kind:%s src00:(%.9g,%.9g) dsrcx:(%.9g,%.9g) dsrcy:(%.9g,%.9g)",
+           fc->seed, fuzz_kind_names[fc->kind], v2_src00.x, v2_src00.y,
+           v2_dsrcx.x, v2_dsrcx.y, v2_dsrcy.x, v2_dsrcy.y);
+    // the perspective is the bottom row of M_inv
+    if(TransformProjective(fc->M_inv)){
+        glm::dvec2 d2_corner;
+        d2project(fc->M_inv,glm::dvec2(1.0,-1.0),&d2_corner);
+        printf(" src11:(%.9g,%.9g) w:(%.9g,%.9g)",d2_corner.x,d2_corner.y,fc->M_inv[0][2],fc->M_inv[1][2]);
+    }
+    if(fc->mirrored){
+        printf(" mirrored");
+    }
+    printf("\n");
+}
+
+template<typename T>
+static int Replay(uint64_t seed, float max_extent, bool perspective)
+{
+    FuzzCase fc;
+    FuzzCaseInit(&fc,seed,max_extent,perspective);
+    BisectEngineT<T> *engine = new BisectEngineT<T>;
+    bool ok = FuzzCaseRun(engine,&fc);
+    FuzzPrintCase(&fc);
+    printf("scalar:%s grid:%dx%d area_error:%g %s\n", ScalarTraits<T>::Name(),
+           engine->Npixelx, engine->Npixely, engine->area_error, ok ? "ok" : "failed");
+    delete engine;
+    return ok ? 0 : 2;
+}
+
+#define FUZZ_CHUNK 1024
+
+template<typename T>
+static int Fuzz(long long n_cases, uint64_t run_seed, int n_threads, float max_extent, int n_worst,
+                bool perspective, const char *corpus_out)
+{
+    n_threads = EmulateThreadCount(n_threads);
+    std::vector<FuzzStats> stats(n_threads);
+    std::atomic<long long> next_case(0);
+
+    // the case seeds only depend on the run seed and the index of the
+    // case, not on which thread runs it
+    auto worker = [&](FuzzStats *fs){
+        BisectEngineT<T> *engine = new BisectEngineT<T>;
+        FuzzStatsInit(fs);
+        long long begin;
+        while((begin = next_case.fetch_add(FUZZ_CHUNK))<n_cases){
+            long long end = std::min(begin + FUZZ_CHUNK,n_cases);
+            for(long long i=begin;i<end;i++){
+                uint64_t state = run_seed ^ (uint64_t)i*0xd1342543de82ef95ull;
+                FuzzResult r;
+                FuzzCaseInit(&r.fc,FuzzNext(&state),max_extent,perspective);
+                bool ok = FuzzCaseRun(engine,&r.fc);
+                r.area_error = engine->area_error;
+                r.error = fabsf(r.area_error);
+                r.index = i;
+                fs->histogram[FuzzBin(r.error)]++;
+                fs->cases[r.fc.kind]++;
+                if(!ok){
+                    fs->failed[r.fc.kind]++;
+                    if(corpus_out) fs->failures.push_back(r);
+                }
+                FuzzStatsAddWorst(fs,r,n_worst);
+            }
+        }
+        delete engine;
+    };
+
+    auto t_start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for(int t=1;t<n_threads;t++){
+        threads.push_back(std::thread(worker,&stats[t]));
+    }
+    worker(&stats[0]);
+    for(size_t t=0;t<threads.size();t++){
+        threads[t].join();
+    }
+    auto t_end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(t_end - t_start).count();
+
+    FuzzStats total;
+    FuzzStatsInit(&total);
+    for(int t=0;t<n_threads;t++){
+        for(int b=0;b<FUZZ_BINS;b++) total.histogram[b] += stats[t].histogram[b];
+        for(int k=0;k<FUZZ_KINDS;k++){
+            total.cases[k] += stats[t].cases[k];
+            total.failed[k] += stats[t].failed[k];
+        }
+        for(const FuzzResult &r : stats[t].worst) FuzzStatsAddWorst(&total,r,n_worst);
+    }
+
+    long long failed = 0;
+    for(int k=0;k<FUZZ_KINDS;k++) failed += total.failed[k];
+    printf("cases:%lld failed:%lld threads:%d scalar:%s seed:0x%016" PRIx64
+           " time:%.3fs rate:%.0f cases/s\n",
+           n_cases, failed, n_threads, ScalarTraits<T>::Name(), run_seed,
+           seconds, n_cases/seconds);
+    for(int k=0;k<FUZZ_KINDS;k++){
+        printf("  %-14s cases:%-10lld failed:%lld\n",
+               fuzz_kind_names[k], total.cases[k], total.failed[k]);
+    }
+    printf("|area_error| histogram\n");
+    for(int b=0;b<FUZZ_BINS;b++){
+        if(b==0){
+            printf("  %-10s", "0");
+        }else if(b==1){
+            printf("  <1e-%-6d", 9);
+        }else if(b==FUZZ_BINS-1){
+            printf("  >=1e-%-5d", 1);
+        }else{
+            printf("  1e-%-7d", 10-b);
+        }
+        printf(" %lld\n", total.histogram[b]);
+    }
+    printf("worst %zu, replay with -r seed\n", total.worst.size());
+    for(const FuzzResult &r : total.worst){
+        printf("  area_error:%-12g ", r.error);
+        FuzzPrintCase(&r.fc);
+    }
+    if(corpus_out){
+        std::vector<FuzzResult> failures;
+        for(int t=0;t<n_threads;t++){
+            failures.insert(failures.end(),stats[t].failures.begin(),stats[t].failures.end());
+        }
+        std::sort(failures.begin(),failures.end(),
+                  [](const FuzzResult &a, const FuzzResult &b){ return a.index<b.index; });
+        // every case is a transform of its own with one record, destination
+        // pixel (0,0) bisected on its own
+        CorpusBuilder builder;
+        FailPixel pixel = {0,0,1,0};
+        for(FuzzResult &r : failures){
+            glm::vec2 v2_src00, v2_dsrcx, v2_dsrcy;
+            FuzzFootprint(&r.fc,&v2_src00,&v2_dsrcx,&v2_dsrcy);
+            CorpusBuilderAddTransform(&builder,r.fc.M_inv,v2_dsrcx,v2_dsrcy,
+                                      ScalarTraits<T>::Name(),false);
+            CorpusBuilderAddRecord(&builder,v2_src00,r.area_error,pixel);
+        }
+        if(!CorpusBuilderWrite(&builder,corpus_out)) return 1;
+        printf("recorded %zu failures in %s\n", failures.size(), corpus_out);
+    }
+    return failed ? 2 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    long long n_cases = 1000000;
+    uint64_t run_seed = 1;
+    int n_threads = 0;
+    float max_extent = 16.0f;
+    int n_worst = 10;
+    const char *scalar = "float";
+    bool perspective = false;
+    bool replay = false;
+    uint64_t replay_seed = 0;
+    const char *corpus_out = NULL;
+    const char *counters_out = NULL;
+    int opt;
+    while((opt = getopt(argc, argv, "n:S:j:m:k:t:pr:W:J:")) != -1){
+        switch(opt){
+        case 'n':
+            n_cases = atoll(optarg);
+            break;
+        case 'S':
+            run_seed = strtoull(optarg,NULL,0);
+            break;
+        case 'j':
+            n_threads = atoi(optarg);
+            break;
+        case 'm':
+            max_extent = atof(optarg);
+            break;
+        case 'k':
+            n_worst = atoi(optarg);
+            break;
+        case 't':
+            scalar = optarg;
+            break;
+        case 'p':
+            perspective = true;
+            break;
+        case 'r':
+            replay = true;
+            replay_seed = strtoull(optarg,NULL,0);
+            break;
+        case 'W':
+            corpus_out = optarg;
+            break;
+        case 'J':
+            counters_out = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if(n_cases<=0 || max_extent<1.0f || n_worst<0
+            || (strcmp(scalar,"float") && strcmp(scalar,"double") && strcmp(scalar,"fixed"))){
+        usage(argv[0]);
+        return 1;
+    }
+
+    int status;
+    if(replay){
+        if(!strcmp(scalar,"double")) status = Replay<double>(replay_seed,max_extent,perspective);
+        else if(!strcmp(scalar,"fixed")) status = Replay<fixed32>(replay_seed,max_extent,perspective);
+        else status = Replay<float>(replay_seed,max_extent,perspective);
+    }else if(!strcmp(scalar,"double")){
+        status = Fuzz<double>(n_cases,run_seed,n_threads,max_extent,n_worst,perspective,corpus_out);
+    }else if(!strcmp(scalar,"fixed")){
+        status = Fuzz<fixed32>(n_cases,run_seed,n_threads,max_extent,n_worst,perspective,corpus_out);
+    }else{
+        status = Fuzz<float>(n_cases,run_seed,n_threads,max_extent,n_worst,perspective,corpus_out);
+    }
+    if(counters_out){
+        BisectCounters counters;
+        BisectCountersTotal(&counters);
+        if(!BisectCountersWriteJSON(&counters,counters_out)) status = 1;
+    }
+    return status;
+}
@@ -0,0 +1,46 @@
+#include "arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+void ScratchArenaInit(ScratchArena *arena)
+{
+    arena->base = NULL;
+    arena->capacity = 0;
+    arena->used = 0;
+}
+
+void ScratchArenaFree(ScratchArena *arena)
+{
+    free(arena->base);
+    ScratchArenaInit(arena);
+}
+
+void ScratchArenaReset(ScratchArena *arena, size_t bytes)
+{
+    arena->used = 0;
+    if(bytes<=arena->capacity){
+        return;
+    }
+    // leave some headroom so a slowly growing footprint does not
+    // reallocate every time
+    size_t capacity = ARENA_SIZE(bytes + bytes/2);
+    free(arena->base);
+    arena->base = (char*)aligned_alloc(ARENA_ALIGN,capacity);
+    if(!arena->base){
+        fprintf(stderr,"scratch arena: out of memory for %zu bytes\n",capacity);
+        abort();
+    }
+    arena->capacity = capacity;
+}
+
+void *ScratchArenaAlloc(ScratchArena *arena, size_t bytes)
+{
+    void *p = arena->base + arena->used;
+    arena->used += ARENA_SIZE(bytes);
+    if(arena->used>arena->capacity){
+        fprintf(stderr,"scratch arena: %zu bytes over the reserved %zu\n",
+                arena->used,arena->capacity);
+        abort();
+    }
+    return p;
+}
@@ -0,0 +1,28 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+//
+// Bump allocator for per-thread scratch. ScratchArenaReset rewinds it and
+// makes room for the bytes about to be carved out. The block only grows
+// when a new high-water mark is reached and is kept until the arena is
+// freed, so the hot loop does not allocate.
+//
+struct ScratchArena {
+    char *base;
+    size_t capacity;
+    size_t used;
+};
+
+#define ARENA_ALIGN 64
+
+void ScratchArenaInit(ScratchArena *arena);
+void ScratchArenaFree(ScratchArena *arena);
+void ScratchArenaReset(ScratchArena *arena, size_t bytes);
+void *ScratchArenaAlloc(ScratchArena *arena, size_t bytes);
+
+// bytes to reserve for an allocation of `bytes` including the alignment
+#define ARENA_SIZE(bytes) ((((size_t)(bytes)) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+#endif // ARENA_H
@@ -0,0 +1,678 @@
+#include "bisect.h"
+#include "counters.h"
+#include <math.h>
+
+glm::vec2 v2conform_axis(glm::vec2 v){
+    glm::vec2 v_abs = glm::abs(v);
+    if(v_abs.x>=v_abs.y){
+        float tan_theta = v_abs.y/v_abs.x;
+        if(tan_theta < 1e-3){
+            v_abs.y=0;
+        }
+    }else{
+        float tan_theta = v_abs.x/v_abs.y;
+        if(tan_theta < 1e-3){
+            v_abs.x=0;
+        }
+    }
+    return v_abs * glm::sign(v);
+}
+
+void SrcPolygonInitVertices(SrcPolygon *sp, glm::vec2 *vertices, glm::mat3 &M)
+{
+    for(int v=0;v<4;v++){
+        glm::vec3 vw(vertices[v],1.0f);
+        glm::vec3 vwp = M*vw;
+        sp->vertices[v].v0 = glm::vec2(vwp);
+    }
+
+}
+
+//
+// Places the footprint of the destination pixel whose top left corner maps
+// to v2_src00. A transform with a reflection would wind the vertices
+// clockwise, so the steps are swapped to keep the winding counter clockwise.
+//
+template<typename T>
+void SrcPolygonInitParallelogram(SrcPolygonT<T> *sp, typename ScalarTraits<T>::vec2 v2_src00,
+                                 typename ScalarTraits<T>::vec2 v2_dsrcx, typename ScalarTraits<T>::vec2 v2_dsrcy)
+{
+    if(ScalarTraits<T>::Cross(v2_dsrcy,v2_dsrcx)<0){
+        typename ScalarTraits<T>::vec2 t = v2_dsrcx;
+        v2_dsrcx = v2_dsrcy;
+        v2_dsrcy = t;
+    }
+    sp->vertices[0].v0 = v2_src00;
+    sp->vertices[1].v0 = v2_src00 + v2_dsrcy;
+    sp->vertices[2].v0 = v2_src00 + v2_dsrcy + v2_dsrcx;
+    sp->vertices[3].v0 = v2_src00 + v2_dsrcx;
+}
+
+//
+// The corners are taken in reverse when they wind clockwise, the quad
+// mirrored by a reflection, as the steps are swapped for a parallelogram.
+//
+template<typename T>
+void SrcPolygonInitQuad(SrcPolygonT<T> *sp, typename ScalarTraits<T>::vec2 *corners)
+{
+    bool clockwise = ScalarTraits<T>::Cross(corners[2]-corners[0],corners[3]-corners[1])<0;
+    sp->vertices[0].v0 = corners[0];
+    sp->vertices[1].v0 = corners[clockwise ? 3 : 1];
+    sp->vertices[2].v0 = corners[2];
+    sp->vertices[3].v0 = corners[clockwise ? 1 : 3];
+}
+
+bool TransformProjective(const glm::mat3 &M)
+{
+    // glm is column major, M[c][2] is the bottom row. The inverse of an
+    // affine transform leaves rounding in the w-terms, relative to M[2][2].
+    float tolerance = 1e-6f*fabsf(M[2][2]);
+    return fabsf(M[0][2])>tolerance || fabsf(M[1][2])>tolerance;
+}
+
+glm::mat3 TransformNormalize(const glm::mat3 &M)
+{
+    glm::mat3 M_n;
+    for(int c=0;c<3;c++){
+        M_n[c] = M[c]/M[2][2];
+    }
+    if(!TransformProjective(M_n)){
+        M_n[0][2] = 0.0f;
+        M_n[1][2] = 0.0f;
+    }
+    M_n[2][2] = 1.0f;
+    return M_n;
+}
+
+bool d2project(const glm::mat3 &M, glm::dvec2 v, glm::dvec2 *v_src)
+{
+    glm::dvec3 v3 = glm::dmat3(M)*glm::dvec3(v,1.0);
+    if(!(v3.z>0.0)){
+        *v_src = glm::dvec2(0.0);
+        return false;
+    }
+    *v_src = glm::dvec2(v3)/v3.z;
+    return true;
+}
+
+template<typename T>
+void SrcPolygonInitEdges(SrcPolygonT<T> *sp)
+{
+    typedef ScalarTraits<T> S;
+    for(int i_v0=0;i_v0<4;i_v0++){
+        int i_v1 = i_v0 + 1;
+        if(i_v1==4)i_v1 = 0;
+        typename S::vec2 v10 = sp->vertices[i_v1].v0 - sp->vertices[i_v0].v0;
+        sp->vertices[i_v0].v10 = v10;
+        sp->vertices[i_v0].N = S::EdgeNormal(v10);
+        sp->vertices[i_v0].o = S::EdgeOrigin(sp->vertices[i_v0].v0,sp->vertices[i_v1].v0);
+        sp->vertices[i_v0].limit = S::InsideLimit(sp->vertices[i_v0].N);
+        sp->vertices[i_v0].x_per_y = S::Slope(v10.x,v10.y);
+        sp->vertices[i_v0].y_per_x = S::Slope(v10.y,v10.x);
+    }
+}
+
+template<typename T>
+int f2BisectSrcPolygon(SrcPolygonT<T> *sp, typename ScalarTraits<T>::vec2 v)
+{
+    typedef ScalarTraits<T> S;
+    int r=0;
+    int inside_bit = 1;
+    typename S::wide f_test;
+    for(int e=0;e<4;e++,inside_bit<<=1){
+        typename S::vec2 vv0 = v - sp->vertices[e].o;
+        f_test = S::Dot(vv0,sp->vertices[e].N);
+        if(f_test > sp->vertices[e].limit){
+            r|=inside_bit;
+        }
+    }
+    return r;
+}
+
+template<typename T>
+void LineCrossingsReset(LineCrossingsT<T> *lc, typename ScalarTraits<T>::vec2 a, typename ScalarTraits<T>::vec2 b)
+{
+    typedef ScalarTraits<T> S;
+    glm::ivec2 i2_min(S::Floor(glm::min(a.x,b.x)),S::Floor(glm::min(a.y,b.y)));
+    glm::ivec2 i2_max(-S::Floor(-glm::max(a.x,b.x)),-S::Floor(-glm::max(a.y,b.y)));
+    LineCrossingT<T> unknown;
+    unknown.known = false;
+    lc->i2_min = i2_min;
+    lc->xLines.assign((size_t)(i2_max.x - i2_min.x) + 1, unknown);
+    lc->yLines.assign((size_t)(i2_max.y - i2_min.y) + 1, unknown);
+}
+
+//
+// The crossing of source edge sv with a0,a1, a part of a horizontal or a
+// vertical pixel edge. The pixel edge fixes one coordinate and the other
+// one is read off the source edge with its slope, a multiply-add in place
+// of the general solve of S::Intersection, and clamped to a0,a1 as the
+// general solve clamps. A source edge parallel to the pixel edge has no
+// finite slope and is left to S::Intersection.
+//
+template<typename T>
+static typename ScalarTraits<T>::vec2 f2CrossingHorizontal(typename ScalarTraits<T>::vec2 a0, typename ScalarTraits<T>::vec2 a1,
+                                                           SrcVertexT<T> *sv)
+{
+    BISECT_COUNT(axis_crossings);
+    T x = sv->v0.x + (a0.y - sv->v0.y)*sv->x_per_y;
+    if(!isfinite(x)){
+        BISECT_COUNT(axis_fallbacks);
+        return ScalarTraits<T>::Intersection(a0,a1,sv->v0,sv->v10);
+    }
+    x = glm::clamp(x,glm::min(a0.x,a1.x),glm::max(a0.x,a1.x));
+    return typename ScalarTraits<T>::vec2(x,a0.y);
+}
+
+template<typename T>
+static typename ScalarTraits<T>::vec2 f2CrossingVertical(typename ScalarTraits<T>::vec2 a0, typename ScalarTraits<T>::vec2 a1,
+                                                         SrcVertexT<T> *sv)
+{
+    BISECT_COUNT(axis_crossings);
+    T y = sv->v0.y + (a0.x - sv->v0.x)*sv->y_per_x;
+    if(!isfinite(y)){
+        BISECT_COUNT(axis_fallbacks);
+        return ScalarTraits<T>::Intersection(a0,a1,sv->v0,sv->v10);
+    }
+    y = glm::clamp(y,glm::min(a0.y,a1.y),glm::max(a0.y,a1.y));
+    return typename ScalarTraits<T>::vec2(a0.x,y);
+}
+
+//
+// num/den rounded half away from zero, den > 0
+//
+static int64_t FixedRound(__int128 num, __int128 den)
+{
+    return (int64_t)((num>=0) ? (2*num + den)/(2*den) : -((-2*num + den)/(2*den)));
+}
+
+//
+// In fixed point the offset of the crossing from a0 along the pixel edge
+// is one exact quotient, num/den clamped to the extent of a0,a1 and
+// rounded as ScalarTraits<fixed32>::Intersection rounds, so the crossings
+// are the same as those of the general solve.
+//
+static int64_t FixedAxisOffset(__int128 num, int64_t den, int64_t extent)
+{
+    if(den<0){
+        den = -den;
+        num = -num;
+    }
+    __int128 lo = (__int128)glm::min(extent,(int64_t)0)*den;
+    __int128 hi = (__int128)glm::max(extent,(int64_t)0)*den;
+    if(num<lo) num = lo;
+    if(num>hi) num = hi;
+    return FixedRound(num,den);
+}
+
+template<>
+fixed2 f2CrossingHorizontal<fixed32>(fixed2 a0, fixed2 a1, SrcVertexT<fixed32> *sv)
+{
+    BISECT_COUNT(axis_crossings);
+    int64_t den = sv->v10.y.raw;
+    if(den==0){
+        BISECT_COUNT(axis_fallbacks);
+        return ScalarTraits<fixed32>::Intersection(a0,a1,sv->v0,sv->v10);
+    }
+    // x - a0.x = ((b0.x-a0.x)*b10.y + (a0.y-b0.y)*b10.x)/b10.y
+    __int128 num = (__int128)((int64_t)sv->v0.x.raw - a0.x.raw)*den
+                 + (__int128)((int64_t)a0.y.raw - sv->v0.y.raw)*sv->v10.x.raw;
+    int64_t dx = FixedAxisOffset(num,den,(int64_t)a1.x.raw - a0.x.raw);
+    return fixed2(fixed32::FromRaw((int32_t)(a0.x.raw + dx)),a0.y);
+}
+
+template<>
+fixed2 f2CrossingVertical<fixed32>(fixed2 a0, fixed2 a1, SrcVertexT<fixed32> *sv)
+{
+    BISECT_COUNT(axis_crossings);
+    int64_t den = sv->v10.x.raw;
+    if(den==0){
+        BISECT_COUNT(axis_fallbacks);
+        return ScalarTraits<fixed32>::Intersection(a0,a1,sv->v0,sv->v10);
+    }
+    // y - a0.y = ((b0.y-a0.y)*b10.x + (a0.x-b0.x)*b10.y)/b10.x
+    __int128 num = (__int128)((int64_t)sv->v0.y.raw - a0.y.raw)*den
+                 + (__int128)((int64_t)a0.x.raw - sv->v0.x.raw)*sv->v10.y.raw;
+    int64_t dy = FixedAxisOffset(num,den,(int64_t)a1.y.raw - a0.y.raw);
+    return fixed2(a0.x,fixed32::FromRaw((int32_t)(a0.y.raw + dy)));
+}
+
+//
+// the crossing of a0,a1, a part of the pixel edge pe, with edge e of the
+// source polygon. With a shared line the crossing is taken over the whole
+// pixel edge, so it does not depend on how far the edge has been clipped,
+// and it is looked up in or recorded into the crossings of the line.
+//
+template<typename T>
+static typename ScalarTraits<T>::vec2 f2EdgeCrossing(PixelEdgeT<T> *pe, typename ScalarTraits<T>::vec2 a0, typename ScalarTraits<T>::vec2 a1,
+                                                     SrcPolygonT<T> *sp, int e, LineCrossingsT<T> **crossings)
+{
+    typedef ScalarTraits<T> S;
+    LineCrossingsT<T> *lc = crossings ? crossings[e] : NULL;
+    bool horizontal = pe->v_ends[0].y==pe->v_ends[1].y;
+    if(!lc){
+        return horizontal ? f2CrossingHorizontal(a0,a1,&sp->vertices[e])
+                          : f2CrossingVertical(a0,a1,&sp->vertices[e]);
+    }
+    LineCrossingT<T> *slot = NULL;
+    T s;
+    if(horizontal){
+        size_t i = (size_t)(S::Trunc(pe->v_ends[0].y) - lc->i2_min.y);
+        if(i<lc->yLines.size()) slot = &lc->yLines[i];
+        s = pe->v_ends[0].x;
+    }else{
+        size_t i = (size_t)(S::Trunc(pe->v_ends[0].x) - lc->i2_min.x);
+        if(i<lc->xLines.size()) slot = &lc->xLines[i];
+        s = pe->v_ends[0].y;
+    }
+    if(slot && slot->known && slot->s==s){
+        return slot->v;
+    }
+    typename S::vec2 v = horizontal ? f2CrossingHorizontal(pe->v_ends[0],pe->v_ends[1],&sp->vertices[e])
+                                    : f2CrossingVertical(pe->v_ends[0],pe->v_ends[1],&sp->vertices[e]);
+    if(slot && !slot->known){
+        slot->known = true;
+        slot->s = s;
+        slot->v = v;
+    }
+    return v;
+}
+
+template<typename T>
+void PixelEdgeBisectSrcPolygon(PixelEdgeT<T> *pe, SrcPolygonT<T> *sp, LineCrossingsT<T> **crossings)
+{
+    // test for all outside of any edge
+    if((~pe->inside_ends[0])&(~pe->inside_ends[1])&0b1111){
+        return;
+    }
+    // find the intersecting edges
+    int intersecting = pe->inside_ends[0]^pe->inside_ends[1];
+    int edge_bit = 1;
+    for(int e=0;e<4;e++,edge_bit<<=1){
+        if(!(edge_bit&intersecting)) continue;
+        switch(pe->code){
+        case 0:
+            if(edge_bit&pe->inside_ends[0]){
+                // v0 is inside
+                pe->code = 1;
+                pe->v_edge[1] = f2EdgeCrossing(pe,pe->v_ends[0],pe->v_ends[1],sp,e,crossings);
+                pe->inside_edge[1] = f2BisectSrcPolygon(sp,pe->v_edge[1]);
+                pe->vflag_edge[1] = edge_bit;
+            }else{
+                // v1 is inside
+                pe->code = 2;
+                pe->v_edge[0] = f2EdgeCrossing(pe,pe->v_ends[0],pe->v_ends[1],sp,e,crossings);
+                pe->inside_edge[0] = f2BisectSrcPolygon(sp,pe->v_edge[0]);
+                pe->vflag_edge[0] = edge_bit;
+            }
+            break;
+        case 1:
+            // test for all outside
+            if((~pe->inside_ends[0])&(~pe->inside_edge[1])&edge_bit){
+                pe->code = 0;
+                return;
+            }
+            // test for an intersection
+            if((pe->inside_ends[0]^pe->inside_edge[1])&edge_bit){
+                if(pe->inside_ends[0]&edge_bit){
+                    // v0 is inside
+                    pe->code = 1;
+                    pe->v_edge[1] = f2EdgeCrossing(pe,pe->v_ends[0],pe->v_edge[1],sp,e,crossings);
+                    pe->inside_edge[1] = f2BisectSrcPolygon(sp,pe->v_edge[1]);
+                    pe->vflag_edge[1] = edge_bit;
+                }else{
+                    // v_edge[1] is inside
+                    pe->code = 3;
+                    pe->v_edge[0] = f2EdgeCrossing(pe,pe->v_ends[0],pe->v_edge[1],sp,e,crossings);
+                    pe->inside_edge[0] = f2BisectSrcPolygon(sp,pe->v_edge[0]);
+                    pe->vflag_edge[0] = edge_bit;
+                }
+            }
+            break;
+        case 2:
+            // test for all outside
+            if((~pe->inside_ends[1])&(~pe->inside_edge[0])&edge_bit){
+                pe->code = 0;
+                return;
+            }
+            // test for intersection with this edge
+            if((pe->inside_ends[1]^pe->inside_edge[0])&edge_bit){
+                if(pe->inside_ends[1]&edge_bit){
+                    // v1 is inside
+                    pe->code = 2;
+                    pe->v_edge[0] = f2EdgeCrossing(pe,pe->v_edge[0],pe->v_ends[1],sp,e,crossings);
+                    pe->inside_edge[0] = f2BisectSrcPolygon(sp,pe->v_edge[0]);
+                    pe->vflag_edge[0] = edge_bit;
+                }else{
+                    // edge->v[0] is inside
+                    pe->code = 3;
+                    pe->v_edge[1] = f2EdgeCrossing(pe,pe->v_edge[0],pe->v_ends[1],sp,e,crossings);
+                    pe->inside_edge[1] = f2BisectSrcPolygon(sp,pe->v_edge[1]);
+                    pe->vflag_edge[1] = edge_bit;
+                }
+            }
+            break;
+        case 3:
+            // test for all outside
+            if((~pe->inside_edge[0])&(~pe->inside_edge[1])&0b1111){
+                pe->code = 0;
+                return;
+            }
+            // test for intersection with this edge
+            if((pe->inside_edge[0]^pe->inside_edge[1])&edge_bit){
+                if(pe->inside_edge[0]&edge_bit){
+                    pe->code = 3;
+                    pe->v_edge[1] = f2EdgeCrossing(pe,pe->v_edge[0],pe->v_edge[1],sp,e,crossings);
+                    pe->inside_edge[1] = f2BisectSrcPolygon(sp,pe->v_edge[1]);
+                    pe->vflag_edge[1] = edge_bit;
+                }else{
+                    pe->code = 3;
+                    pe->v_edge[0] = f2EdgeCrossing(pe,pe->v_edge[0],pe->v_edge[1],sp,e,crossings);
+                    pe->inside_edge[0] = f2BisectSrcPolygon(sp,pe->v_edge[0]);
+                    pe->vflag_edge[0] = edge_bit;
+                }
+            }
+            break;
+        }
+    }
+}
+
+template<typename T>
+void PixelEdgeBorderBisectSrcPolygon(PixelEdgeT<T> *pe, SrcPolygonT<T> *sp, LineCrossingsT<T> **crossings)
+{
+    // the only case to bisect a border edge is when there is
+    // one intersection and the rest are all inside
+    int intersecting = pe->inside_ends[0]^pe->inside_ends[1];
+    int all_inside = pe->inside_ends[0]&pe->inside_ends[1];
+    switch(intersecting){
+    case 1:
+        if(all_inside==0b1110){
+            if(pe->inside_ends[0]&intersecting){
+                // v0 is inside
+                pe->code = 1;
+                pe->v_edge[1] = f2EdgeCrossing(pe,pe->v_ends[0],pe->v_ends[1],sp,0,crossings);
+                pe->vflag_edge[1] = 0b0001;
+            }else{
+                // v1 is inside
+                pe->code = 2;
+                pe->v_edge[0] = f2EdgeCrossing(pe,pe->v_ends[0],pe->v_ends[1],sp,0,crossings);
+                pe->vflag_edge[0] = 0b0001;
+            }
+        }
+        return;
+    case 2:
+        if(all_inside==0b1101){
+            if(pe->inside_ends[0]&intersecting){
+                // v0 is inside
+                pe->code = 1;
+                pe->v_edge[1] = f2EdgeCrossing(pe,pe->v_ends[0],pe->v_ends[1],sp,1,crossings);
+                pe->vflag_edge[1] = 0b0010;
+            }else{
+                // v1 is inside
+                pe->code = 2;
+                pe->v_edge[0] = f2EdgeCrossing(pe,pe->v_ends[0],pe->v_ends[1],sp,1,crossings);
+                pe->vflag_edge[0] = 0b0010;
+            }
+        }
+        return;
+    case 4:
+        if(all_inside==0b1011){
+            if(pe->inside_ends[0]&intersecting){
+                // v0 is inside
+                pe->code = 1;
+                pe->v_edge[1] = f2EdgeCrossing(pe,pe->v_ends[0],pe->v_ends[1],sp,2,crossings);
+                pe->vflag_edge[1] = 0b0100;
+            }else{
+                // v1 is inside
+                pe->code = 2;
+                pe->v_edge[0] = f2EdgeCrossing(pe,pe->v_ends[0],pe->v_ends[1],sp,2,crossings);
+                pe->vflag_edge[0] = 0b0100;
+            }
+        }
+        return;
+    case 8:
+        if(all_inside==0b0111){
+            if(pe->inside_ends[0]&intersecting){
+                // v0 is inside
+                pe->code = 1;
+                pe->v_edge[1] = f2EdgeCrossing(pe,pe->v_ends[0],pe->v_ends[1],sp,3,crossings);
+                pe->vflag_edge[1] = 0b1000;
+            }else{
+                // v1 is inside
+                pe->code = 2;
+                pe->v_edge[0] = f2EdgeCrossing(pe,pe->v_ends[0],pe->v_ends[1],sp,3,crossings);
+                pe->vflag_edge[0] = 0b1000;
+            }
+        }
+        return;
+    default:
+        return;
+    }
+}
+
+template<typename T, typename V>
+static V IntersectionDelta(V a0, V a1, V b0, V b10)
+{
+    BISECT_COUNT(intersections);
+    V d_a = a1-a0;
+    V r_a0b0;
+    bool swap_a;
+    T d_a_dot_d_b = glm::dot(d_a,b10);
+    if(d_a_dot_d_b<(T)0){
+        // swap a0 and a1 and start over
+        d_a *= (T)-1;
+        d_a_dot_d_b *= (T)-1;
+        r_a0b0 = a1 - b0;
+        swap_a = true;
+    }else{
+        r_a0b0 = a0 - b0;
+        swap_a = false;
+    }
+    T d_a_dot_d_a = glm::dot(d_a,d_a);
+    T d_b_dot_d_b = glm::dot(b10,b10);
+    T d_ab_dot_d_a = glm::dot(r_a0b0,d_a);
+    T d_ab_dot_d_b = glm::dot(r_a0b0,b10);
+    T t_num_p = d_a_dot_d_b*d_ab_dot_d_b;
+    T t_num_m = d_b_dot_d_b*d_ab_dot_d_a;
+    T t_det = d_a_dot_d_a*d_b_dot_d_b - d_a_dot_d_b*d_a_dot_d_b;
+    T t = (t_num_p - t_num_m) / t_det;
+    if(!isfinite(t)){
+        BISECT_COUNT(intersection_fallbacks);
+        t=(T)0.5;
+    }
+    if(t<(T)0)t=(T)0;
+    if(t>(T)1)t=(T)1;
+    if(swap_a){
+        return a1 + d_a*t;
+    }else{
+        return a0 + d_a*t;
+    }
+}
+
+glm::vec2 f2IntersectionDelta(glm::vec2 a0, glm::vec2 a1, glm::vec2 b0, glm::vec2 b10)
+{
+    return IntersectionDelta<float>(a0,a1,b0,b10);
+}
+
+glm::vec2 ScalarTraits<float>::Intersection(glm::vec2 a0, glm::vec2 a1, glm::vec2 b0, glm::vec2 b10)
+{
+    return IntersectionDelta<float>(a0,a1,b0,b10);
+}
+
+glm::dvec2 ScalarTraits<double>::Intersection(glm::dvec2 a0, glm::dvec2 a1, glm::dvec2 b0, glm::dvec2 b10)
+{
+    return IntersectionDelta<double>(a0,a1,b0,b10);
+}
+
+//
+// a0 + (a1-a0)*num/den rounded to the nearest step, den > 0
+//
+static int32_t FixedLerp(int32_t a0, int32_t a1, __int128 num, __int128 den)
+{
+    __int128 q = (__int128)(a1 - a0)*num*2;
+    __int128 d = den*2;
+    // round half away from zero, the same on every compiler
+    __int128 r = (q>=0) ? (q + den)/d : -((-q + den)/d);
+    return (int32_t)(a0 + r);
+}
+
+//
+// The crossing of a0,a1 with the line through b0 along b10 in exact
+// integer arithmetic. The parameter along a is num/den with 128 bit
+// cross products, only the final point is rounded.
+//
+fixed2 ScalarTraits<fixed32>::Intersection(fixed2 a0, fixed2 a1, fixed2 b0, fixed2 b10)
+{
+    int64_t dax = (int64_t)a1.x.raw - a0.x.raw;
+    int64_t day = (int64_t)a1.y.raw - a0.y.raw;
+    BISECT_COUNT(intersections);
+    __int128 den = (__int128)dax*b10.y.raw - (__int128)day*b10.x.raw;
+    if(den==0){
+        BISECT_COUNT(intersection_fallbacks);
+        return fixed2(fixed32::FromRaw((int32_t)((a0.x.raw + (int64_t)a1.x.raw)/2)),
+                      fixed32::FromRaw((int32_t)((a0.y.raw + (int64_t)a1.y.raw)/2)));
+    }
+    int64_t rx = (int64_t)b0.x.raw - a0.x.raw;
+    int64_t ry = (int64_t)b0.y.raw - a0.y.raw;
+    __int128 num = (__int128)rx*b10.y.raw - (__int128)ry*b10.x.raw;
+    if(den<0){
+        den = -den;
+        num = -num;
+    }
+    if(num<0) num = 0;
+    if(num>den) num = den;
+    return fixed2(fixed32::FromRaw(FixedLerp(a0.x.raw,a1.x.raw,num,den)),
+                  fixed32::FromRaw(FixedLerp(a0.y.raw,a1.y.raw,num,den)));
+}
+
+glm::ivec2 convert_ivec2_plus(glm::vec2 v)
+{
+    glm::ivec2 r = v;
+    if(v.x<0.0f) r.x--;
+    if(v.y>0.0f) r.y++;
+    return r;
+}
+
+float f2cross(glm::vec2 &a, glm::vec2 &b)
+{
+    return a.x*b.y - a.y*b.x;
+}
+
+template<typename T>
+glm::ivec2 ConvertIVec2Plus(typename ScalarTraits<T>::vec2 v)
+{
+    typedef ScalarTraits<T> S;
+    glm::ivec2 r(S::Trunc(v.x),S::Trunc(v.y));
+    if(v.x<T(0)) r.x--;
+    if(v.y>T(0)) r.y++;
+    return r;
+}
+
+template<typename T>
+float SrcPolygonArea(SrcPolygonT<T> *sp)
+{
+    // the two triangles either side of the diagonal v0 v2 of the convex
+    // quad, the cross products of their sides are exact in fixed point
+    typedef ScalarTraits<T> S;
+    typename S::wide area = S::Cross(sp->vertices[0].v10,sp->vertices[1].v10)
+            + S::Cross(sp->vertices[2].v10,sp->vertices[3].v10);
+    return S::WideToFloat(area)/2.0f;
+}
+
+template<typename T>
+void PolygonAddVertex(PolygonT<T> *p, typename ScalarTraits<T>::vec2 &v)
+{
+    p->v[p->N] = v;
+    p->N++;
+}
+
+//
+// the shoelace sum is taken in the product type, exact for fixed point,
+// and halved once converted
+//
+template<typename T>
+float PolygonArea(PolygonT<T> *p)
+{
+    typedef ScalarTraits<T> S;
+    if(p->N<3)return 0.0f;
+    int Ntri = p->N - 2;
+    typename S::vec2 v0 = p->v[0];
+    typename S::wide area = 0;
+    for(int t=0;t<Ntri;t++){
+        typename S::vec2 v10 = p->v[t+1] - v0;
+        typename S::vec2 v21 = p->v[t+2] - p->v[t+1];
+        area += S::Cross(v10,v21);
+    }
+    return S::WideToFloat(area)/2.0f;
+}
+
+template<typename T>
+void EdgeFunctionsInit(EdgeFunctionsT<T> *ef, SrcPolygonT<T> *sp, typename ScalarTraits<T>::vec2 v)
+{
+    typedef ScalarTraits<T> S;
+    typename S::vec2 step_x = S::FromInt(glm::ivec2(1,0));
+    typename S::vec2 step_y = S::FromInt(glm::ivec2(0,-1));
+    for(int e=0;e<4;e++){
+        ef->f[e] = S::Dot(v - sp->vertices[e].o,sp->vertices[e].N);
+        ef->step_x[e] = S::Dot(step_x,sp->vertices[e].N);
+        ef->step_y[e] = S::Dot(step_y,sp->vertices[e].N);
+    }
+}
+
+template<typename T>
+void EdgeFunctionsStepX(EdgeFunctionsT<T> *ef, int dx)
+{
+    for(int e=0;e<4;e++){
+        ef->f[e] += ef->step_x[e]*dx;
+    }
+}
+
+template<typename T>
+void EdgeFunctionsStepY(EdgeFunctionsT<T> *ef)
+{
+    for(int e=0;e<4;e++){
+        ef->f[e] += ef->step_y[e];
+    }
+}
+
+//
+// the plain row loop, the float rows have vector kernels
+//
+template<typename T>
+void f2BisectSrcPolygonRow(SrcPolygonT<T> *sp, const EdgeFunctionsT<T> *ef, int n, int *inside)
+{
+    typename ScalarTraits<T>::wide f[4], limit[4];
+    for(int e=0;e<4;e++){
+        f[e] = ef->f[e];
+        limit[e] = sp->vertices[e].limit;
+    }
+    for(int i=0;i<n;i++){
+        inside[i] = (f[0]>limit[0] ? 1 : 0) | (f[1]>limit[1] ? 2 : 0)
+                  | (f[2]>limit[2] ? 4 : 0) | (f[3]>limit[3] ? 8 : 0);
+        for(int e=0;e<4;e++){
+            f[e] += ef->step_x[e];
+        }
+    }
+}
+
+#define BISECT_INSTANTIATE(T) \
+    template void SrcPolygonInitParallelogram<T>(SrcPolygonT<T>*, ScalarTraits<T>::vec2, ScalarTraits<T>::vec2, ScalarTraits<T>::vec2); \
+    template void SrcPolygonInitQuad<T>(SrcPolygonT<T>*, ScalarTraits<T>::vec2*); \
+    template void SrcPolygonInitEdges<T>(SrcPolygonT<T>*); \
+    template float SrcPolygonArea<T>(SrcPolygonT<T>*); \
+    template int f2BisectSrcPolygon<T>(SrcPolygonT<T>*, ScalarTraits<T>::vec2); \
+    template void EdgeFunctionsInit<T>(EdgeFunctionsT<T>*, SrcPolygonT<T>*, ScalarTraits<T>::vec2); \
+    template void EdgeFunctionsStepX<T>(EdgeFunctionsT<T>*, int); \
+    template void EdgeFunctionsStepY<T>(EdgeFunctionsT<T>*); \
+    template void LineCrossingsReset<T>(LineCrossingsT<T>*, ScalarTraits<T>::vec2, ScalarTraits<T>::vec2); \
+    template void PixelEdgeBisectSrcPolygon<T>(PixelEdgeT<T>*, SrcPolygonT<T>*, LineCrossingsT<T>**); \
+    template void PixelEdgeBorderBisectSrcPolygon<T>(PixelEdgeT<T>*, SrcPolygonT<T>*, LineCrossingsT<T>**); \
+    template glm::ivec2 ConvertIVec2Plus<T>(ScalarTraits<T>::vec2); \
+    template void PolygonAddVertex<T>(PolygonT<T>*, ScalarTraits<T>::vec2&); \
+    template float PolygonArea<T>(PolygonT<T>*);
+
+BISECT_INSTANTIATE(float)
+BISECT_INSTANTIATE(double)
+BISECT_INSTANTIATE(fixed32)
+template void f2BisectSrcPolygonRow<double>(SrcPolygonT<double>*, const EdgeFunctionsT<double>*, int, int*);
+template void f2BisectSrcPolygonRow<fixed32>(SrcPolygonT<fixed32>*, const EdgeFunctionsT<fixed32>*, int, int*);
@@ -0,0 +1,175 @@
+#ifndef BISECT_H
+#define BISECT_H
+
+#include "scalar.h"
+#include <glm/gtx/matrix_transform_2d.hpp>
+#include <vector>
+
+#define GRID_SIZE 32
+
+//
+// vertex bits
+//
+
+#define V0_BIT 0b0001
+#define V1_BIT 0b0010
+#define V2_BIT 0b0100
+#define V3_BIT 0b1000
+
+
+//
+// The geometry is templated on the scalar type, see scalar.h. The float
+// instantiation keeps the plain names and is the one the viewer and the
+// SIMD row kernels use. The templates are instantiated for float, double
+// and fixed32 in bisect.cpp.
+//
+
+template<typename T>
+struct SrcVertexT
+{
+    typedef typename ScalarTraits<T>::vec2 vec2;
+    vec2 v0;
+    vec2 v10;
+    vec2 N;
+    vec2 o;   // origin of the inside test on the edge
+    typename ScalarTraits<T>::wide limit;  // inside if dot(v-o,N) > limit
+    T x_per_y;  // v10.x/v10.y, the crossings with horizontal pixel edges
+    T y_per_x;  // v10.y/v10.x, the crossings with vertical pixel edges
+};
+
+template<typename T>
+struct SrcPolygonT
+{
+    SrcVertexT<T> vertices[4];
+};
+
+typedef SrcVertexT<float> SrcVertex;
+typedef SrcPolygonT<float> SrcPolygon;
+
+void SrcPolygonInitVertices(SrcPolygon *sp, glm::vec2 *vertices, glm::mat3 &M);
+template<typename T>
+void SrcPolygonInitParallelogram(SrcPolygonT<T> *sp, typename ScalarTraits<T>::vec2 v2_src00,
+                                 typename ScalarTraits<T>::vec2 v2_dsrcx, typename ScalarTraits<T>::vec2 v2_dsrcy);
+// corners of a convex quad in the order top left, bottom left, bottom
+// right and top right of the destination pixel it is the footprint of
+template<typename T> void SrcPolygonInitQuad(SrcPolygonT<T> *sp, typename ScalarTraits<T>::vec2 *corners);
+template<typename T> void SrcPolygonInitEdges(SrcPolygonT<T> *sp);
+template<typename T> float SrcPolygonArea(SrcPolygonT<T> *sp);
+
+//
+// A perspective maps destination point v to (M*v)/w, w the last component
+// of M*v, so its bottom row is not (0,0,1). The footprint of a destination
+// pixel is then a general convex quad that changes shape from pixel to
+// pixel, as long as w>0 at the corners of the pixel. Pixels reaching the
+// horizon at w<=0 have no footprint.
+//
+bool TransformProjective(const glm::mat3 &M);
+//
+// scales M so that M[2][2] is 1 and drops the rounding of an affine
+// inverse from the w-terms. The affine paths read the source point off
+// M*v without a divide, so a transform is normalised once it is built.
+//
+glm::mat3 TransformNormalize(const glm::mat3 &M);
+// in double, so that a thin quad keeps its shape in the double engine,
+// false if v is at or behind the horizon
+bool d2project(const glm::mat3 &M, glm::dvec2 v, glm::dvec2 *v_src);
+
+template<typename T>
+struct PixelEdgeT {
+    typedef typename ScalarTraits<T>::vec2 vec2;
+    int code; // the type of edge
+    vec2 v_ends[2]; // the ends of the edge
+    int inside_ends[2];  // inside flags for the ends
+    vec2 v_edge[2]; // vertices inside the edge
+    int inside_edge[2];  // inside flags for the vertices inside the edge
+    int vflag_edge[2];   // the vertex flags for the vertices inside the edge
+};
+
+typedef PixelEdgeT<float> PixelEdge;
+
+//
+// The four edge functions dot(v-o,N) of the source polygon at one lattice
+// vertex. The lattice steps by exactly (1,0) along a row and (0,-1) down
+// a column, so the functions at the next vertex are the running values
+// plus N.x or minus N.y and the inside mask is read from them without a
+// product per vertex. In fixed point the steps are exact and the masks
+// are those of f2BisectSrcPolygon. In floating point a step adds a
+// rounding, far inside the InsideLimit band, and the float row kernels
+// take f + i*step_x along the row so only the steps down the rows add up.
+//
+template<typename T>
+struct EdgeFunctionsT {
+    typename ScalarTraits<T>::wide f[4];       // at the current vertex
+    typename ScalarTraits<T>::wide step_x[4];  // change for a step of (1,0)
+    typename ScalarTraits<T>::wide step_y[4];  // change for a step of (0,-1)
+};
+
+typedef EdgeFunctionsT<float> EdgeFunctions;
+
+template<typename T> int f2BisectSrcPolygon(SrcPolygonT<T> *sp, typename ScalarTraits<T>::vec2 v);
+template<typename T> void EdgeFunctionsInit(EdgeFunctionsT<T> *ef, SrcPolygonT<T> *sp, typename ScalarTraits<T>::vec2 v);
+// moves the running values dx vertices along the row
+template<typename T> void EdgeFunctionsStepX(EdgeFunctionsT<T> *ef, int dx);
+// moves the running values to the next row down
+template<typename T> void EdgeFunctionsStepY(EdgeFunctionsT<T> *ef);
+// the inside flags of n vertices along a row, ef holds the edge functions
+// at the first one and is not changed
+template<typename T> void f2BisectSrcPolygonRow(SrcPolygonT<T> *sp, const EdgeFunctionsT<T> *ef, int n, int *inside);
+// the float rows run on the vector kernels of bisect_simd.cpp
+template<> void f2BisectSrcPolygonRow<float>(SrcPolygon *sp, const EdgeFunctions *ef, int n, int *inside);
+const char *f2BisectSrcPolygonRowName(void);
+
+//
+// The crossings of one line of the destination pixel grid with the
+// horizontal and vertical lines of the source grid. Neighbouring
+// destination pixels share these lines, the first one to need a crossing
+// computes it and the other one reuses it. Each grid line crosses the
+// shared line once, so one crossing is kept per grid line together with
+// the start of the pixel edge it was found on.
+//
+template<typename T>
+struct LineCrossingT {
+    bool known;      // false until the crossing is computed
+    T s;             // start of the pixel edge along the grid line
+    typename ScalarTraits<T>::vec2 v;     // the crossing
+};
+
+template<typename T>
+struct LineCrossingsT {
+    glm::ivec2 i2_min;                       // first vertical and horizontal source grid line
+    std::vector<LineCrossingT<T>> xLines;    // crossings with x = i2_min.x + i
+    std::vector<LineCrossingT<T>> yLines;    // crossings with y = i2_min.y + i
+};
+
+typedef LineCrossingT<float> LineCrossing;
+typedef LineCrossingsT<float> LineCrossings;
+
+template<typename T>
+void LineCrossingsReset(LineCrossingsT<T> *lc, typename ScalarTraits<T>::vec2 a, typename ScalarTraits<T>::vec2 b);
+
+template<typename T>
+void PixelEdgeBisectSrcPolygon(PixelEdgeT<T> *pe, SrcPolygonT<T> *sp, LineCrossingsT<T> **crossings = NULL);
+template<typename T>
+void PixelEdgeBorderBisectSrcPolygon(PixelEdgeT<T> *pe, SrcPolygonT<T> *sp, LineCrossingsT<T> **crossings = NULL);
+
+glm::vec2 f2IntersectionDelta(glm::vec2 a0, glm::vec2 a1, glm::vec2 b0, glm::vec2 b10);
+
+glm::ivec2 convert_ivec2_plus(glm::vec2 v);
+template<typename T> glm::ivec2 ConvertIVec2Plus(typename ScalarTraits<T>::vec2 v);
+
+glm::vec2 v2conform_axis(glm::vec2 v);
+
+float f2cross(glm::vec2 &a, glm::vec2 &b);
+
+template<typename T>
+struct PolygonT {
+    int N;
+    typename ScalarTraits<T>::vec2 v[10];
+};
+
+typedef PolygonT<float> Polygon;
+
+template<typename T> void PolygonAddVertex(PolygonT<T> *p, typename ScalarTraits<T>::vec2 &v);
+template<typename T> float PolygonArea(PolygonT<T> *p);
+
+#endif // BISECT_H
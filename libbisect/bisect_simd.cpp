@@ -0,0 +1,169 @@
+#include "bisect.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//
+// Classifies a row of lattice vertices against the four edges of the
+// source polygon from the edge functions at the start of the row. The
+// function at vertex i is f + i*step_x, with i counted exactly in float,
+// so there is one product and one sum per edge instead of the difference
+// and dot product of f2BisectSrcPolygon, and no rounding piles up along
+// the row. The vector kernels evaluate the same products and sums as the
+// scalar one, and FMA is not enabled for them, so the inside masks do not
+// depend on the kernel. The kernel is picked at runtime from what the CPU
+// supports, BISECT_SIMD=scalar, sse4.2, avx2 or avx512 in the environment
+// overrides the choice.
+//
+
+typedef void (*BisectRowFunc)(SrcPolygon *sp, const EdgeFunctions *ef, int n, int *inside);
+
+//
+// vertices i to n-1 of a row, the scalar kernel and the tail of a row
+// after the last full vector
+//
+static void f2BisectSrcPolygonRowTail(SrcPolygon *sp, const EdgeFunctions *ef, int i, int n, int *inside)
+{
+    for(;i<n;i++){
+        float x = (float)i;
+        int r = 0;
+        for(int e=0;e<4;e++){
+            float f = ef->f[e] + x*ef->step_x[e];
+            if(f > sp->vertices[e].limit){
+                r |= 1<<e;
+            }
+        }
+        inside[i] = r;
+    }
+}
+
+static void f2BisectSrcPolygonRowScalar(SrcPolygon *sp, const EdgeFunctions *ef, int n, int *inside)
+{
+    f2BisectSrcPolygonRowTail(sp, ef, 0, n, inside);
+}
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define BISECT_SIMD_X86
+#include <immintrin.h>
+
+__attribute__((target("sse4.2")))
+static void f2BisectSrcPolygonRowSSE(SrcPolygon *sp, const EdgeFunctions *ef, int n, int *inside)
+{
+    __m128 lane = _mm_setr_ps(0.0f,1.0f,2.0f,3.0f);
+    __m128 step = _mm_set1_ps(4.0f);
+    __m128 f0[4], step_x[4], limit[4];
+    for(int e=0;e<4;e++){
+        f0[e] = _mm_set1_ps(ef->f[e]);
+        step_x[e] = _mm_set1_ps(ef->step_x[e]);
+        limit[e] = _mm_set1_ps(sp->vertices[e].limit);
+    }
+    int i;
+    for(i=0;i+4<=n;i+=4,lane=_mm_add_ps(lane,step)){
+        __m128i r = _mm_setzero_si128();
+        for(int e=0;e<4;e++){
+            __m128 f = _mm_add_ps(f0[e],_mm_mul_ps(lane,step_x[e]));
+            __m128i m = _mm_castps_si128(_mm_cmpgt_ps(f,limit[e]));
+            r = _mm_or_si128(r,_mm_and_si128(m,_mm_set1_epi32(1<<e)));
+        }
+        _mm_storeu_si128((__m128i*)(inside+i),r);
+    }
+    f2BisectSrcPolygonRowTail(sp, ef, i, n, inside);
+}
+
+__attribute__((target("avx2")))
+static void f2BisectSrcPolygonRowAVX2(SrcPolygon *sp, const EdgeFunctions *ef, int n, int *inside)
+{
+    __m256 lane = _mm256_setr_ps(0.0f,1.0f,2.0f,3.0f,4.0f,5.0f,6.0f,7.0f);
+    __m256 step = _mm256_set1_ps(8.0f);
+    __m256 f0[4], step_x[4], limit[4];
+    for(int e=0;e<4;e++){
+        f0[e] = _mm256_set1_ps(ef->f[e]);
+        step_x[e] = _mm256_set1_ps(ef->step_x[e]);
+        limit[e] = _mm256_set1_ps(sp->vertices[e].limit);
+    }
+    int i;
+    for(i=0;i+8<=n;i+=8,lane=_mm256_add_ps(lane,step)){
+        __m256i r = _mm256_setzero_si256();
+        for(int e=0;e<4;e++){
+            __m256 f = _mm256_add_ps(f0[e],_mm256_mul_ps(lane,step_x[e]));
+            __m256i m = _mm256_castps_si256(_mm256_cmp_ps(f,limit[e],_CMP_GT_OQ));
+            r = _mm256_or_si256(r,_mm256_and_si256(m,_mm256_set1_epi32(1<<e)));
+        }
+        _mm256_storeu_si256((__m256i*)(inside+i),r);
+    }
+    // the tail is plain SSE code and may be reached by a jump that skips
+    // the vzeroupper of the return, dirty upper halves would slow it down
+    _mm256_zeroupper();
+    f2BisectSrcPolygonRowTail(sp, ef, i, n, inside);
+}
+
+__attribute__((target("avx512f")))
+static void f2BisectSrcPolygonRowAVX512(SrcPolygon *sp, const EdgeFunctions *ef, int n, int *inside)
+{
+    __m512 lane = _mm512_setr_ps(0.0f,1.0f,2.0f,3.0f,4.0f,5.0f,6.0f,7.0f,
+                                 8.0f,9.0f,10.0f,11.0f,12.0f,13.0f,14.0f,15.0f);
+    __m512 step = _mm512_set1_ps(16.0f);
+    __m512 f0[4], step_x[4], limit[4];
+    for(int e=0;e<4;e++){
+        f0[e] = _mm512_set1_ps(ef->f[e]);
+        step_x[e] = _mm512_set1_ps(ef->step_x[e]);
+        limit[e] = _mm512_set1_ps(sp->vertices[e].limit);
+    }
+    int i;
+    for(i=0;i+16<=n;i+=16,lane=_mm512_add_ps(lane,step)){
+        __m512i r = _mm512_setzero_si512();
+        for(int e=0;e<4;e++){
+            __m512 f = _mm512_add_ps(f0[e],_mm512_mul_ps(lane,step_x[e]));
+            // one bit per lane straight out of the compare
+            __mmask16 m = _mm512_cmp_ps_mask(f,limit[e],_CMP_GT_OQ);
+            r = _mm512_mask_or_epi32(r,m,r,_mm512_set1_epi32(1<<e));
+        }
+        _mm512_storeu_si512((void*)(inside+i),r);
+    }
+    _mm256_zeroupper();
+    f2BisectSrcPolygonRowTail(sp, ef, i, n, inside);
+}
+#endif
+
+static const char *bisect_row_name = "scalar";
+
+static BisectRowFunc BisectRowSelect(void)
+{
+    const char *want = getenv("BISECT_SIMD");
+#ifdef BISECT_SIMD_X86
+    __builtin_cpu_init();
+    struct {
+        const char *name;
+        bool supported;
+        BisectRowFunc func;
+    } kernels[] = {
+        {"avx512", (bool)__builtin_cpu_supports("avx512f"), f2BisectSrcPolygonRowAVX512},
+        {"avx2", (bool)__builtin_cpu_supports("avx2"), f2BisectSrcPolygonRowAVX2},
+        {"sse4.2", (bool)__builtin_cpu_supports("sse4.2"), f2BisectSrcPolygonRowSSE},
+    };
+    for(int k=0;k<3;k++){
+        if(!kernels[k].supported) continue;
+        if(want && strcmp(want,kernels[k].name)!=0) continue;
+        bisect_row_name = kernels[k].name;
+        return kernels[k].func;
+    }
+#endif
+    if(want && strcmp(want,"scalar")!=0){
+        fprintf(stderr,"BISECT_SIMD=%s not supported, using scalar\n",want);
+    }
+    bisect_row_name = "scalar";
+    return f2BisectSrcPolygonRowScalar;
+}
+
+static BisectRowFunc bisect_row_func = BisectRowSelect();
+
+template<>
+void f2BisectSrcPolygonRow<float>(SrcPolygon *sp, const EdgeFunctions *ef, int n, int *inside)
+{
+    bisect_row_func(sp, ef, n, inside);
+}
+
+const char *f2BisectSrcPolygonRowName(void)
+{
+    return bisect_row_name;
+}
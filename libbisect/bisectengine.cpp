@@ -0,0 +1,1159 @@
+#include "bisectengine.h"
+#include "counters.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <utility>
+
+template<typename T>
+BisectEngineT<T>::BisectEngineT()
+{
+    Npixelx = 0;
+    Npixely = 0;
+    grid_size = 3;
+    area_error = 0.0f;
+    share_edges = false;
+    for(int e=0;e<4;e++){
+        crossings[e] = NULL;
+    }
+    for(int i=0;i<PIXEL_PATHS;i++){
+        path_counts[i] = 0;
+    }
+    edge_walk = true;
+    cover_spans = false;
+    walked = false;
+    ScratchArenaInit(&arena);
+    vertexInside = fixedInside;
+    InitEdgeRows(GRID_SIZE+1,fixedEdgeCodes,fixedEdgeCrossings,fixedEdgeInside,fixedEdgeVFlags);
+    pixelVFlags = fixedVFlags;
+    rowSpans = fixedRowSpans;
+}
+
+template<typename T>
+BisectEngineT<T>::~BisectEngineT()
+{
+    ScratchArenaFree(&arena);
+}
+
+//
+// the flags that choose how the engine sweeps and covers, and the steps
+// of the transform, for a scratch engine doing part of the work of engine
+//
+template<typename T>
+void BisectEngineT<T>::CopySettings(const BisectEngineT<T> *engine)
+{
+    v2_dsrcx = engine->v2_dsrcx;
+    v2_dsrcy = engine->v2_dsrcy;
+    share_edges = engine->share_edges;
+    edge_walk = engine->edge_walk;
+    cover_spans = engine->cover_spans;
+}
+
+//
+// the three edge rows, stride edges apart, two crossings per edge
+//
+template<typename T>
+void BisectEngineT<T>::InitEdgeRows(int stride, int *codes, vec2 *crossings, int *inside, int *vflags)
+{
+    PixelEdgeRow *rows[3] = {&xEdgeRows[0], &xEdgeRows[1], &yEdgeRow};
+    for(int r=0;r<3;r++){
+        rows[r]->code = codes + r*stride;
+        rows[r]->v_edge = crossings + 2*r*stride;
+        rows[r]->inside_edge = inside + 2*r*stride;
+        rows[r]->vflag_edge = vflags + 2*r*stride;
+    }
+}
+
+//
+// point the grids and the edge rows at the fixed arrays or, for a large
+// footprint, at the arena
+//
+template<typename T>
+void BisectEngineT<T>::InitScratch()
+{
+    if(Npixelx<=GRID_SIZE && Npixely<=GRID_SIZE){
+        vertexInside = fixedInside;
+        InitEdgeRows(GRID_SIZE+1,fixedEdgeCodes,fixedEdgeCrossings,fixedEdgeInside,fixedEdgeVFlags);
+        pixelVFlags = fixedVFlags;
+        rowSpans = fixedRowSpans;
+        return;
+    }
+    size_t n_vertices = (size_t)(Npixelx+1)*(Npixely+1);
+    size_t n_edges = (size_t)3*(Npixelx+1);
+    size_t n_pixels = (size_t)Npixelx*Npixely;
+    ScratchArenaReset(&arena,
+                      ARENA_SIZE(n_vertices*sizeof(int)) +
+                      ARENA_SIZE(n_edges*sizeof(int)) +
+                      ARENA_SIZE(2*n_edges*sizeof(vec2)) +
+                      2*ARENA_SIZE(2*n_edges*sizeof(int)) +
+                      ARENA_SIZE(n_pixels*sizeof(int)) +
+                      ARENA_SIZE(Npixely*sizeof(RowSpan)));
+    vertexInside = (int*)ScratchArenaAlloc(&arena,n_vertices*sizeof(int));
+    int *codes = (int*)ScratchArenaAlloc(&arena,n_edges*sizeof(int));
+    vec2 *crossings = (vec2*)ScratchArenaAlloc(&arena,2*n_edges*sizeof(vec2));
+    int *inside = (int*)ScratchArenaAlloc(&arena,2*n_edges*sizeof(int));
+    int *vflags = (int*)ScratchArenaAlloc(&arena,2*n_edges*sizeof(int));
+    InitEdgeRows(Npixelx+1,codes,crossings,inside,vflags);
+    pixelVFlags = (int*)ScratchArenaAlloc(&arena,n_pixels*sizeof(int));
+    rowSpans = (RowSpan*)ScratchArenaAlloc(&arena,Npixely*sizeof(RowSpan));
+}
+
+template<typename T>
+void BisectEngineT<T>::InitPixels()
+{
+    BISECT_COUNT(init_pixels);
+    glm::ivec2 i2_src0 = ConvertIVec2Plus<T>(srcPolygon.vertices[0].v0);
+    glm::ivec2 i2_src1 = ConvertIVec2Plus<T>(srcPolygon.vertices[1].v0);
+    glm::ivec2 i2_src2 = ConvertIVec2Plus<T>(srcPolygon.vertices[2].v0);
+    glm::ivec2 i2_src3 = ConvertIVec2Plus<T>(srcPolygon.vertices[3].v0);
+
+    glm::ivec2 i2_min = glm::min(glm::min(i2_src0,i2_src1),glm::min(i2_src2,i2_src3));
+    glm::ivec2 i2_max = glm::max(glm::max(i2_src0,i2_src1),glm::max(i2_src2,i2_src3));
+
+    Npixelx = i2_max.x - i2_min.x + 1;
+    Npixely = i2_max.y - i2_min.y + 1;
+
+    i2_v0 = glm::ivec2(i2_min.x,i2_max.y);
+    vec2 v0 = ScalarTraits<T>::FromInt(i2_v0);
+
+    grid_size = (Npixelx>Npixely)?Npixelx:Npixely;
+    if(grid_size<3) grid_size = 3;
+
+    InitScratch();
+
+    walked = false;
+    if(Npixelx==1 && Npixely==1){
+        return;
+    }
+    if(edge_walk && grid_size>=WALK_GRID_SIZE){
+        BISECT_COUNT(walked_grids);
+        glm::ivec2 i2_src[4] = {i2_src0, i2_src1, i2_src2, i2_src3};
+        InitPixelsWalk(i2_src);
+        return;
+    }
+
+    // the edge functions at the first vertex, stepped down the rows
+    EdgeFunctionsT<T> ef;
+    EdgeFunctionsInit(&ef, &srcPolygon, v0);
+    int *inside = vertexInside;
+    int y;
+    for(y=0;y<Npixely+1;y++){
+        f2BisectSrcPolygonRow(&srcPolygon, &ef, Npixelx+1, inside);
+        BISECT_COUNT_N(lattice_points, Npixelx+1);
+        // move the pointer to the next line
+        inside+=Npixelx+1;
+        EdgeFunctionsStepY(&ef);
+    }
+    // initialize the pixel vertex flags to zero
+    memset(pixelVFlags,0,(size_t)Npixelx*Npixely*sizeof(int));
+    // deposit the vertices into the pixels
+    *PixelVFlagAt(i2_src0.x-i2_v0.x,i2_v0.y-i2_src0.y) |= V0_BIT;
+    *PixelVFlagAt(i2_src1.x-i2_v0.x,i2_v0.y-i2_src1.y) |= V1_BIT;
+    *PixelVFlagAt(i2_src2.x-i2_v0.x,i2_v0.y-i2_src2.y) |= V2_BIT;
+    *PixelVFlagAt(i2_src3.x-i2_v0.x,i2_v0.y-i2_src3.y) |= V3_BIT;
+}
+
+//
+// The span of the source polygon on the horizontal line at y. Returns
+// false if the line misses the polygon.
+//
+template<typename T>
+static bool SrcPolygonLineSpan(SrcPolygonT<T> *sp, T y, T *x_min, T *x_max)
+{
+    bool found = false;
+    for(int e=0;e<4;e++){
+        typename ScalarTraits<T>::vec2 p = sp->vertices[e].v0;
+        typename ScalarTraits<T>::vec2 q = sp->vertices[(e+1)&3].v0;
+        if((p.y>y && q.y>y) || (p.y<y && q.y<y)) continue;
+        T xa,xb;
+        if(p.y==q.y){
+            xa = std::min(p.x,q.x);
+            xb = std::max(p.x,q.x);
+        }else{
+            xa = xb = p.x + ScalarTraits<T>::MulDiv(y-p.y,q.x-p.x,q.y-p.y);
+        }
+        if(!found){
+            *x_min = xa;
+            *x_max = xb;
+            found = true;
+        }else{
+            *x_min = std::min(*x_min,xa);
+            *x_max = std::max(*x_max,xb);
+        }
+    }
+    return found;
+}
+
+//
+// Walks the edges of the source polygon down the rows of the grid. The
+// crossings of the edges with the two lines bounding a row give the
+// pixels of the row the boundary passes through, the pixels between them
+// are covered and the rest are empty. Only the vertices of the boundary
+// pixels are tested against the polygon and only their vertex flags are
+// cleared, so the cost grows with the perimeter of the footprint and not
+// with its area. Rows with a source vertex in them have no covered span.
+//
+template<typename T>
+void BisectEngineT<T>::InitPixelsWalk(glm::ivec2 *i2_src)
+{
+    typedef ScalarTraits<T> S;
+    const T eps = S::FromFloat(1e-4f);
+    SrcVertexT<T> *sv = srcPolygon.vertices;
+    T x_left = T(i2_v0.x);
+    int vertex_rows[4];
+    for(int i=0;i<4;i++){
+        vertex_rows[i] = i2_v0.y - i2_src[i].y;
+    }
+    for(int y=0;y<Npixely;y++){
+        RowSpan *span = &rowSpans[y];
+        T y_top = T(i2_v0.y - y);
+        T y_bottom = T(i2_v0.y - y - 1);
+        T a_top, b_top, a_bottom, b_bottom;
+        bool top = SrcPolygonLineSpan(&srcPolygon,y_top,&a_top,&b_top);
+        bool bottom = SrcPolygonLineSpan(&srcPolygon,y_bottom,&a_bottom,&b_bottom);
+        bool found = top || bottom;
+        T x_min = top ? a_top : a_bottom;
+        T x_max = top ? b_top : b_bottom;
+        if(top && bottom){
+            x_min = std::min(x_min,a_bottom);
+            x_max = std::max(x_max,b_bottom);
+        }
+        bool vertex_row = false;
+        for(int i=0;i<4;i++){
+            if(sv[i].v0.y<=y_top && sv[i].v0.y>=y_bottom){
+                x_min = found ? std::min(x_min,sv[i].v0.x) : sv[i].v0.x;
+                x_max = found ? std::max(x_max,sv[i].v0.x) : sv[i].v0.x;
+                found = true;
+            }
+            if(vertex_rows[i]==y) vertex_row = true;
+        }
+        if(!found){
+            span->x0 = 0;
+            span->x1 = -1;
+            span->x2 = 0;
+            span->x3 = -1;
+            continue;
+        }
+        span->x0 = glm::max(0,S::Floor(x_min - x_left - eps));
+        span->x3 = glm::min(Npixelx-1,S::Floor(x_max - x_left + eps));
+        int covered0 = 0;
+        int covered1 = -1;
+        if(top && bottom && !vertex_row){
+            // ceil
+            covered0 = -S::Floor(x_left - eps - std::max(a_top,a_bottom));
+            covered1 = S::Floor(std::min(b_top,b_bottom) - x_left - eps) - 1;
+        }
+        if(covered0>covered1){
+            span->x1 = span->x3;
+            span->x2 = span->x3+1;
+        }else{
+            span->x1 = glm::max(covered0-1,span->x0-1);
+            span->x2 = glm::min(covered1+1,span->x3+1);
+        }
+    }
+
+    //
+    // the vertices of the boundary pixels of the rows above and below
+    //
+    EdgeFunctionsT<T> ef;
+    EdgeFunctionsInit(&ef, &srcPolygon, S::FromInt(i2_v0));
+    for(int y=0;y<Npixely+1;y++,EdgeFunctionsStepY(&ef)){
+        int left0 = Npixelx, left1 = -1;
+        int right0 = Npixelx, right1 = -1;
+        for(int r=y-1;r<=y;r++){
+            if(r<0 || r>=Npixely) continue;
+            RowSpan *span = &rowSpans[r];
+            if(span->x0<=span->x1){
+                left0 = glm::min(left0,span->x0);
+                left1 = glm::max(left1,span->x1+1);
+            }
+            if(span->x2<=span->x3){
+                right0 = glm::min(right0,span->x2);
+                right1 = glm::max(right1,span->x3+1);
+            }
+        }
+        if(right0<=left1+1){
+            left0 = glm::min(left0,right0);
+            left1 = glm::max(left1,right1);
+            right1 = -1;
+        }
+        if(left0<=left1){
+            EdgeFunctionsT<T> ef_left = ef;
+            EdgeFunctionsStepX(&ef_left, left0);
+            f2BisectSrcPolygonRow(&srcPolygon, &ef_left, left1-left0+1, VertexInsideAt(left0,y));
+            BISECT_COUNT_N(lattice_points, left1-left0+1);
+        }
+        if(right0<=right1){
+            EdgeFunctionsT<T> ef_right = ef;
+            EdgeFunctionsStepX(&ef_right, right0);
+            f2BisectSrcPolygonRow(&srcPolygon, &ef_right, right1-right0+1, VertexInsideAt(right0,y));
+            BISECT_COUNT_N(lattice_points, right1-right0+1);
+        }
+    }
+
+    for(int y=0;y<Npixely;y++){
+        RowSpan *span = &rowSpans[y];
+        if(span->x0<=span->x1){
+            memset(PixelVFlagAt(span->x0,y),0,(span->x1-span->x0+1)*sizeof(int));
+        }
+        if(span->x2<=span->x3){
+            memset(PixelVFlagAt(span->x2,y),0,(span->x3-span->x2+1)*sizeof(int));
+        }
+    }
+    *PixelVFlagAt(i2_src[0].x-i2_v0.x,i2_v0.y-i2_src[0].y) |= V0_BIT;
+    *PixelVFlagAt(i2_src[1].x-i2_v0.x,i2_v0.y-i2_src[1].y) |= V1_BIT;
+    *PixelVFlagAt(i2_src[2].x-i2_v0.x,i2_v0.y-i2_src[2].y) |= V2_BIT;
+    *PixelVFlagAt(i2_src[3].x-i2_v0.x,i2_v0.y-i2_src[3].y) |= V3_BIT;
+    walked = true;
+}
+
+template<typename T>
+static inline void PixelEdgeInitEnds(PixelEdgeT<T> *pe, typename ScalarTraits<T>::vec2 v0, int inside0,
+                                     typename ScalarTraits<T>::vec2 v1, int inside1)
+{
+    pe->code = 0;
+    pe->v_ends[0] = v0;
+    pe->inside_ends[0] = inside0;
+    pe->v_ends[1] = v1;
+    pe->inside_ends[1] = inside1;
+}
+
+//
+// keeps what the bisection of pe found as edge i of the row
+//
+template<typename T>
+static inline void PixelEdgeRowStore(PixelEdgeRowT<T> *row, int i, PixelEdgeT<T> *pe)
+{
+    row->code[i] = pe->code;
+    if(pe->code){
+        for(int k=0;k<2;k++){
+            row->v_edge[2*i+k] = pe->v_edge[k];
+            row->inside_edge[2*i+k] = pe->inside_edge[k];
+            row->vflag_edge[2*i+k] = pe->vflag_edge[k];
+        }
+    }
+}
+
+//
+// unpacks edge i of the row into pe, whose ends are already set
+//
+template<typename T>
+static inline void PixelEdgeRowLoad(PixelEdgeRowT<T> *row, int i, PixelEdgeT<T> *pe)
+{
+    pe->code = row->code[i];
+    if(pe->code){
+        for(int k=0;k<2;k++){
+            pe->v_edge[k] = row->v_edge[2*i+k];
+            pe->inside_edge[k] = row->inside_edge[2*i+k];
+            pe->vflag_edge[k] = row->vflag_edge[2*i+k];
+        }
+    }
+}
+
+//
+// true if v is within snap of one of the source vertices in vflag
+//
+template<typename T>
+static bool SrcPolygonVFlagVertex(SrcPolygonT<T> *sp, int vflag, typename ScalarTraits<T>::vec2 v, T snap)
+{
+    for(int i=0;i<4;i++){
+        typename ScalarTraits<T>::vec2 d = sp->vertices[i].v0 - v;
+        if((vflag&(1<<i)) && d.x<=snap && d.x>=T(0)-snap && d.y<=snap && d.y>=T(0)-snap){
+            return true;
+        }
+    }
+    return false;
+}
+
+//
+// Bisects the edges of pixel (x,y) that have not been visited yet and
+// assembles the clipped polygon of the pixel into `polygon`. The pixels
+// must be visited in raster order since the top and left edges are taken
+// from the previous row and column. `top_fresh` and `left_fresh` mark a
+// top or left edge whose neighbour was skipped by the walk.
+//
+template<typename T>
+void BisectEngineT<T>::BisectPixel(int x, int y, bool top_fresh, bool left_fresh)
+{
+    int inside00 = *VertexInsideAt(x,y);
+    int inside10 = *VertexInsideAt(x+1,y);
+    int inside01 = *VertexInsideAt(x,y+1);
+    int inside11 = *VertexInsideAt(x+1,y+1);
+    // the lattice is integer, the steps are exact in every T
+    vec2 v00 = VertexAt(x,y);
+    vec2 v10 = v00 + ScalarTraits<T>::FromInt(glm::ivec2(1,0));
+    vec2 v01 = v00 + ScalarTraits<T>::FromInt(glm::ivec2(0,-1));
+    vec2 v11 = v01 + ScalarTraits<T>::FromInt(glm::ivec2(1,0));
+    PixelEdge edges[4];
+    PixelEdge *xEdgeTop = &edges[0];
+    PixelEdge *xEdgeBottom = &edges[1];
+    PixelEdge *yEdgeLeft = &edges[2];
+    PixelEdge *yEdgeRight = &edges[3];
+    PixelEdgeInitEnds(xEdgeTop,v00,inside00,v10,inside10);
+    PixelEdgeInitEnds(xEdgeBottom,v01,inside01,v11,inside11);
+    PixelEdgeInitEnds(yEdgeLeft,v00,inside00,v01,inside01);
+    PixelEdgeInitEnds(yEdgeRight,v10,inside10,v11,inside11);
+    //
+    // bisect the new edges
+    //
+    // test for the top of the grid, otherwise the top edge is the bottom
+    // edge of the pixel above
+    //
+    if(y==0){
+        PixelEdgeBorderBisectSrcPolygon(xEdgeTop,&srcPolygon,crossings);
+    }else if(top_fresh){
+        PixelEdgeBisectSrcPolygon(xEdgeTop,&srcPolygon,crossings);
+    }else{
+        PixelEdgeRowLoad(XEdgeRow(y),x,xEdgeTop);
+    }
+    //
+    // test for the left most edge, otherwise the left edge is the right
+    // edge of the pixel to the left
+    //
+    if(x==0){
+        PixelEdgeBorderBisectSrcPolygon(yEdgeLeft,&srcPolygon,crossings);
+    }else if(left_fresh){
+        PixelEdgeBisectSrcPolygon(yEdgeLeft,&srcPolygon,crossings);
+    }else{
+        PixelEdgeRowLoad(&yEdgeRow,x,yEdgeLeft);
+    }
+    //
+    // bisect the fresh bottom edge
+    //
+    if(y<(Npixely-1)){
+        PixelEdgeBisectSrcPolygon(xEdgeBottom,&srcPolygon,crossings);
+    }else{
+        PixelEdgeBorderBisectSrcPolygon(xEdgeBottom,&srcPolygon,crossings);
+    }
+    PixelEdgeRowStore(XEdgeRow(y+1),x,xEdgeBottom);
+    //
+    // bisect the fresh right edge
+    //
+    if(x<(Npixelx-1)){
+        PixelEdgeBisectSrcPolygon(yEdgeRight,&srcPolygon,crossings);
+    }else{
+        PixelEdgeBorderBisectSrcPolygon(yEdgeRight,&srcPolygon,crossings);
+    }
+    PixelEdgeRowStore(&yEdgeRow,x+1,yEdgeRight);
+    BISECT_COUNT(pixels_bisected);
+    if(y==0 || top_fresh) BISECT_COUNT(edge_codes[xEdgeTop->code]);
+    if(x==0 || left_fresh) BISECT_COUNT(edge_codes[yEdgeLeft->code]);
+    BISECT_COUNT(edge_codes[xEdgeBottom->code]);
+    BISECT_COUNT(edge_codes[yEdgeRight->code]);
+    //
+    // now create the polygon for this pixel
+    //
+    polygon.N = 0;
+    int pixelVFlag = *PixelVFlagAt(x,y);
+    BISECT_COUNT(pixel_vflags[pixelVFlag&0b1111]);
+    //
+    // the runs of source vertices in the pixel go in before the crossings
+    // their edges leave the pixel by. A vertex on the boundary of the pixel
+    // puts crossings of its edges at its own place, and a run of several
+    // vertices with one there, or whose crossing was lost to it, is drawn
+    // all at once where the boundary of the pixel first runs outside the
+    // source polygon. That is next to those crossings, and where the run
+    // goes in a parallelogram.
+    //
+    bool run_multi = (pixelVFlag&((pixelVFlag<<1)|(pixelVFlag>>3))&0b1111)!=0;
+    bool run_on_edge = false;
+    for(int v=0;run_multi && v<4;v++){
+        vec2 vertex = srcPolygon.vertices[v].v0;
+        if((pixelVFlag&(1<<v)) && (vertex.x==yEdgeLeft->v_ends[0].x || vertex.x==yEdgeRight->v_ends[0].x
+                || vertex.y==xEdgeBottom->v_ends[0].y || vertex.y==xEdgeTop->v_ends[0].y)){
+            run_on_edge = true;
+        }
+    }
+    //
+    // a crossing is tagged with the first source edge found through it.
+    // When two edges pass through the same crossing, at a vertex on or
+    // within rounding of the pixel boundary, the run of the vertex before
+    // can be lost. The polygon is then drawn again letting a crossing near
+    // a vertex stand for it.
+    //
+    bool run_added = false;
+    vflagSnap = T(0);
+    vflagPixel = v00;
+    for(int pass=0;!run_on_edge && pass<2;pass++){
+        polygon.N = 0;
+        vflagsAdded = 0;
+        run_added = PolygonAddEdgeVFlagForward(&polygon,yEdgeLeft,pixelVFlag,&srcPolygon);
+        run_added |= PolygonAddEdgeVFlagForward(&polygon,xEdgeBottom,pixelVFlag,&srcPolygon);
+        run_added |= PolygonAddEdgeVFlagReverse(&polygon,yEdgeRight,pixelVFlag,&srcPolygon);
+        run_added |= PolygonAddEdgeVFlagReverse(&polygon,xEdgeTop,pixelVFlag,&srcPolygon);
+        if(!(pixelVFlag&~vflagsAdded)) break;
+        vflagSnap = ScalarTraits<T>::FromFloat(VFLAG_SNAP);
+    }
+    if(run_multi && !run_added){
+        //
+        // the run is drawn at the first edge outside from its start. If the
+        // corner after it is a vertex of the run, or within rounding of
+        // one, the corner is left out, the run brings the vertex itself
+        //
+        PixelEdge *edges[4] = {yEdgeLeft,xEdgeBottom,yEdgeRight,xEdgeTop};
+        int run_edge = -1;
+        for(int i=0;i<4 && run_edge<0;i++){
+            // the right and top edges run against the drawing order
+            int end = i<2 ? 0 : 1;
+            if(edges[i]->code==0 && edges[i]->inside_ends[end]!=0b1111){
+                run_edge = i;
+            }
+        }
+        polygon.N = 0;
+        for(int i=0;i<4;i++){
+            if(i==run_edge){
+                PolygonAddMultiVFlag(&polygon, pixelVFlag, &srcPolygon);
+                continue;
+            }
+            int end = i<2 ? 0 : 1;
+            if(edges[i]->code==0 && edges[i]->inside_ends[end]!=0b1111){
+                continue;
+            }
+            int n = polygon.N;
+            if(i<2){
+                PolygonAddEdgeForward(&polygon,edges[i]);
+            }else{
+                PolygonAddEdgeReverse(&polygon,edges[i]);
+            }
+            // an edge starting inside adds its corner first, drop it if the
+            // run was drawn just before
+            if(run_edge==((i+3)&3) && polygon.N>n && edges[i]->inside_ends[end]==0b1111
+                    && SrcPolygonVFlagVertex(&srcPolygon,pixelVFlag,edges[i]->v_ends[end],ScalarTraits<T>::FromFloat(VFLAG_SNAP))){
+                for(int k=n+1;k<polygon.N;k++){
+                    polygon.v[k-1] = polygon.v[k];
+                }
+                polygon.N--;
+            }
+        }
+    }
+    BISECT_COUNT(polygon_n[glm::min(polygon.N,COUNTER_POLYGON_N-1)]);
+}
+
+//
+// Sorts pixel (x,y) out by the inside flags of its corners before any
+// bisection. A pixel with all corners inside every edge is covered, one
+// with all corners outside the same edge is empty. Neither has a
+// source vertex in it nor a crossing on its edges, so the edges later
+// pixels take over are only marked code 0. Returns PIXEL_PARTIAL
+// if the pixel has to go through BisectPixel, in the same raster order.
+//
+template<typename T>
+int BisectEngineT<T>::ClassifyPixel(int x, int y)
+{
+    if(*PixelVFlagAt(x,y)){
+        return PIXEL_PARTIAL;
+    }
+    int *row0 = VertexInsideAt(x,y);
+    int *row1 = VertexInsideAt(x,y+1);
+    int inside_all = row0[0] & row0[1] & row1[0] & row1[1];
+    int inside_any = row0[0] | row0[1] | row1[0] | row1[1];
+    int path;
+    if(inside_all==0b1111){
+        path = PIXEL_COVERED;
+    }else if((~inside_any)&0b1111){
+        path = PIXEL_EMPTY;
+    }else{
+        return PIXEL_PARTIAL;
+    }
+    XEdgeRow(y+1)->code[x] = 0;
+    yEdgeRow.code[x+1] = 0;
+    return path;
+}
+
+//
+// Classifies and if need be bisects pixel (x,y), returns its area
+//
+template<typename T>
+float BisectEngineT<T>::VisitPixel(int x, int y, bool top_fresh, bool left_fresh)
+{
+    int path = ClassifyPixel(x,y);
+    path_counts[path]++;
+    if(path==PIXEL_COVERED){
+        return 1.0f;
+    }else if(path==PIXEL_EMPTY){
+        return 0.0f;
+    }
+    BisectPixel(x,y,top_fresh,left_fresh);
+    return PolygonArea(&polygon);
+}
+
+//
+// true if pixel (x,y) is in the boundary spans of its row, the edges of
+// the pixels outside them are never set up
+//
+template<typename T>
+bool BisectEngineT<T>::RowSpanVisited(int x, int y)
+{
+    RowSpan *span = &rowSpans[y];
+    return (x>=span->x0 && x<=span->x1) || (x>=span->x2 && x<=span->x3);
+}
+
+template<typename T>
+bool BisectEngineT<T>::BisectAndVerifyPixels()
+{
+    int x;
+    int y;
+    area_error = 0.0f;
+    if(Npixelx==1 && Npixely==1){
+        return true;
+    }
+    float src_area = SrcPolygonArea(&srcPolygon);
+    float total_area = 0.0f;
+    if(walked){
+        for(y=0;y<Npixely;y++){
+            RowSpan *span = &rowSpans[y];
+            for(x=span->x0;x<=span->x1;x++){
+                total_area += VisitPixel(x,y,y>0 && !RowSpanVisited(x,y-1),x==span->x0);
+            }
+            int covered = span->x2 - span->x1 - 1;
+            total_area += (float)covered;
+            for(x=span->x2;x<=span->x3;x++){
+                total_area += VisitPixel(x,y,y>0 && !RowSpanVisited(x,y-1),x==span->x2);
+            }
+            int boundary = glm::max(span->x1-span->x0+1,0) + glm::max(span->x3-span->x2+1,0);
+            path_counts[PIXEL_COVERED] += covered;
+            path_counts[PIXEL_EMPTY] += Npixelx - boundary - covered;
+        }
+    }else{
+        for(y=0;y<Npixely;y++){
+            for(x=0;x<Npixelx;x++){
+                total_area += VisitPixel(x,y,false,false);
+            }
+        }
+    }
+    area_error = (total_area - src_area)/src_area;
+    if(fabsf(area_error)>0.001f){
+        return false;
+    }
+    return true;
+}
+
+//
+// Fills `coverage` with the area of the source polygon inside each of the
+// source pixels it touches. Pixels with no area are left out. With
+// cover_spans set the pixels between the edges of a walked row, which all
+// have area 1, go to coveredSpans as one run instead.
+//
+template<typename T>
+void BisectEngineT<T>::BisectAndCoverPixels()
+{
+    PixelCoverage pc;
+    coverage.clear();
+    coveredSpans.clear();
+    if(Npixelx==1 && Npixely==1){
+        pc.i2_pixel = glm::ivec2(i2_v0.x,-i2_v0.y);
+        pc.area = SrcPolygonArea(&srcPolygon);
+        coverage.push_back(pc);
+        return;
+    }
+    for(int y=0;y<Npixely;y++){
+        int x_begin = 0;
+        int x_end = Npixelx;
+        RowSpan *span = NULL;
+        if(walked){
+            span = &rowSpans[y];
+            x_begin = glm::min(span->x0,span->x2);
+            x_end = glm::max(span->x1,span->x3)+1;
+            int boundary = glm::max(span->x1-span->x0+1,0) + glm::max(span->x3-span->x2+1,0);
+            path_counts[PIXEL_COVERED] += span->x2 - span->x1 - 1;
+            path_counts[PIXEL_EMPTY] += Npixelx - boundary - (span->x2 - span->x1 - 1);
+            if(cover_spans && span->x2 - span->x1 - 1>0){
+                CoverageSpan cs;
+                cs.i2_pixel = glm::ivec2(i2_v0.x + span->x1 + 1, y - i2_v0.y);
+                cs.n = span->x2 - span->x1 - 1;
+                coveredSpans.push_back(cs);
+            }
+        }
+        for(int x=x_begin;x<x_end;x++){
+            if(!walked){
+                pc.area = VisitPixel(x,y,false,false);
+            }else if(x>span->x1 && x<span->x2){
+                if(cover_spans){
+                    x = span->x2 - 1;
+                    continue;
+                }
+                pc.area = 1.0f;
+            }else{
+                pc.area = VisitPixel(x,y,y>0 && !RowSpanVisited(x,y-1),
+                                     x==span->x0 || x==span->x2);
+            }
+            if(pc.area>0.0f){
+                pc.i2_pixel = glm::ivec2(i2_v0.x + x, y - i2_v0.y);
+                coverage.push_back(pc);
+            }
+        }
+    }
+}
+
+//
+// Places the parallelogram of a destination pixel given in float
+// coordinates. The corner and the steps are converted before they are
+// added, so the footprint is an exact parallelogram in T.
+//
+template<typename T>
+void BisectEngineT<T>::InitPolygon(glm::vec2 v2_src00, glm::vec2 v2_dsrcx, glm::vec2 v2_dsrcy)
+{
+    typedef ScalarTraits<T> S;
+    SrcPolygonInitParallelogram(&srcPolygon,S::FromFloat(v2_src00),S::FromFloat(v2_dsrcx),S::FromFloat(v2_dsrcy));
+    SrcPolygonInitEdges(&srcPolygon);
+}
+
+//
+// Places the quad that destination pixel (x,y) maps to under a projective
+// M_inv, see d2project. The corners are mapped one by one, the same way as
+// in the shared edge sweep. Returns false if the pixel reaches the
+// horizon.
+//
+template<typename T>
+bool BisectEngineT<T>::InitQuad(glm::mat3 &M_inv, int x, int y)
+{
+    typedef ScalarTraits<T> S;
+    const glm::ivec2 i2_corners[4] = {
+        glm::ivec2(x,y), glm::ivec2(x,y+1), glm::ivec2(x+1,y+1), glm::ivec2(x+1,y)
+    };
+    vec2 corners[4];
+    for(int i=0;i<4;i++){
+        glm::dvec2 d2_corner;
+        if(!d2project(M_inv,glm::dvec2(i2_corners[i].x,-i2_corners[i].y),&d2_corner)){
+            return false;
+        }
+        corners[i] = S::FromDouble(d2_corner);
+    }
+    SrcPolygonInitQuad(&srcPolygon,corners);
+    SrcPolygonInitEdges(&srcPolygon);
+    return true;
+}
+
+//
+// the steps across the source for one destination pixel in x and y
+//
+template<typename T>
+void BisectEngineT<T>::InitTransform(glm::mat3 &M_inv)
+{
+    glm::vec3 v3_dx(1.0f,0.0f,0.0f);
+    glm::vec3 v3_dy(0.0f,-1.0f,0.0f);
+    v2_dsrcx = v2conform_axis(glm::vec2(M_inv*v3_dx));
+    v2_dsrcy = v2conform_axis(glm::vec2(M_inv*v3_dy));
+}
+
+template<typename T>
+void BisectEngineT<T>::EmulateTransform(int width, int height, glm::mat3 &M_inv)
+{
+    InitTransform(M_inv);
+    fail_vector.clear();
+    fail_errors.clear();
+    fail_pixels.clear();
+    for(int i=0;i<PIXEL_PATHS;i++){
+        path_counts[i] = 0;
+    }
+    EmulateTransformRows(width,0,height,M_inv);
+}
+
+//
+// Verifies the destination rows y_begin to y_end-1. Failures are appended
+// to fail_vector, fail_errors and fail_pixels in raster order. InitTransform must have
+// been called. A projective M_inv gives every pixel its own quad, the
+// pixels reaching the horizon are skipped.
+//
+template<typename T>
+void BisectEngineT<T>::EmulateTransformRows(int width, int y_begin, int y_end, glm::mat3 &M_inv)
+{
+    if(share_edges){
+        EmulateTransformRowsShared(width,y_begin,y_end,M_inv);
+        return;
+    }
+    typedef ScalarTraits<T> S;
+    vec2 dsrcx = S::FromFloat(v2_dsrcx);
+    vec2 dsrcy = S::FromFloat(v2_dsrcy);
+    bool projective = TransformProjective(M_inv);
+    for(int y=y_begin;y<y_end;y++){
+        glm::vec3 v3_y(0.0f,-(float)y,1.0f);
+        glm::vec2 v2_src00(M_inv*v3_y);
+        for(int x=0;x<width;x++,v2_src00+=v2_dsrcx){
+            if(projective){
+                if(!InitQuad(M_inv,x,y)) continue;
+                v2_src00 = S::ToFloat(srcPolygon.vertices[0].v0);
+            }else{
+                SrcPolygonInitParallelogram(&srcPolygon,S::FromFloat(v2_src00),dsrcx,dsrcy);
+                SrcPolygonInitEdges(&srcPolygon);
+            }
+            InitPixels();
+            if(!BisectAndVerifyPixels()){
+                fail_vector.push_back(v2_src00);
+                fail_errors.push_back(area_error);
+                fail_pixels.push_back(FailPixel{x,y,width,y_begin});
+            }
+        }
+    }
+}
+
+//
+// Verifies a pixel of the shared edge sweep again. The crossings of the
+// lines it shares were found by the neighbours swept before it, so its
+// row is swept again together with the row above, unless its row was the
+// first of its sweep. The steps must be those of the sweep, see
+// InitTransform. Returns false if the pixel still fails, area_error is
+// then its error.
+//
+template<typename T>
+bool BisectEngineT<T>::VerifySharedPixel(glm::mat3 &M_inv, FailPixel pixel)
+{
+    int y_begin = pixel.y>pixel.y_begin ? pixel.y - 1 : pixel.y_begin;
+    fail_vector.clear();
+    fail_errors.clear();
+    fail_pixels.clear();
+    EmulateTransformRowsShared(pixel.width,y_begin,pixel.y + 1,M_inv);
+    for(size_t i=0;i<fail_pixels.size();i++){
+        if(fail_pixels[i].x==pixel.x && fail_pixels[i].y==pixel.y){
+            area_error = fail_errors[i];
+            return false;
+        }
+    }
+    return true;
+}
+
+//
+// w>0 at the four corners of destination pixel (x,y), w is affine in the
+// destination so it is then positive over the whole pixel
+//
+static bool ProjectiveQuadVisible(glm::mat3 &M_inv, int x, int y)
+{
+    glm::dvec2 d2_corner;
+    for(int i=0;i<4;i++){
+        if(!d2project(M_inv,glm::dvec2(x + (i&1),-(y + (i>>1))),&d2_corner)) return false;
+    }
+    return true;
+}
+
+//
+// Row sweep where neighbouring destination pixels share their edges. The
+// corners of the destination pixels are mapped once per row, so a shared
+// edge has exactly the same end points in both pixels, and the crossings
+// of every shared line with the source grid are computed once and handed
+// to the neighbour. Together with the inside test measured from the edge
+// midpoints this makes the coverage of neighbours watertight within rows
+// y_begin to y_end-1, row y_begin shares nothing with the row above it.
+// The corners are laid out on an exact lattice, so many more of them fall
+// on the source grid lines than in EmulateTransformRows, see
+// PolygonAddVFlagRun. Under a projective M_inv the corners are mapped one
+// by one as in InitQuad.
+//
+template<typename T>
+void BisectEngineT<T>::EmulateTransformRowsShared(int width, int y_begin, int y_end, glm::mat3 &M_inv)
+{
+    //
+    // the destination edge that each polygon edge lies on, swapped with
+    // the steps when the transform has a reflection
+    //
+    bool projective = TransformProjective(M_inv);
+    bool reflected = f2cross(v2_dsrcy,v2_dsrcx)<0.0f;
+    if(projective){
+        // the sign of the Jacobian of a perspective is that of its
+        // determinant wherever w>0
+        reflected = glm::determinant(M_inv)<0.0f;
+    }
+    LineCrossings *left = &colLines[0];
+    LineCrossings *right = &colLines[1];
+    LineCrossings *top = &rowLines[0];
+    LineCrossings *bottom = &rowLines[1];
+    std::vector<vec2> *topCorners = &corners[0];
+    std::vector<vec2> *bottomCorners = &corners[1];
+    for(int r=0;r<2;r++){
+        corners[r].resize(width+1);
+    }
+
+    //
+    // the corners are laid out from the conformed steps, so edges snapped
+    // onto an axis stay exactly on it, and each corner only depends on its
+    // own x and y
+    //
+    typedef ScalarTraits<T> S;
+    glm::vec3 v3_origin(0.0f,0.0f,1.0f);
+    vec2 v2_origin = S::FromFloat(glm::vec2(M_inv*v3_origin));
+    vec2 dsrcx = S::FromFloat(v2_dsrcx);
+    vec2 dsrcy = S::FromFloat(v2_dsrcy);
+    for(int y=y_begin;y<y_end;y++){
+        for(int r=(y==y_begin)?0:1;r<2;r++){
+            std::vector<vec2> &row = (r==0)?*topCorners:*bottomCorners;
+            vec2 v2_row = v2_origin + dsrcy*T(y+r);
+            for(int x=0;x<=width;x++){
+                if(projective){
+                    glm::dvec2 d2_corner;
+                    d2project(M_inv,glm::dvec2(x,-(y+r)),&d2_corner);
+                    row[x] = S::FromDouble(d2_corner);
+                }else{
+                    row[x] = v2_row + dsrcx*T(x);
+                }
+            }
+        }
+        if(y==y_begin){
+            LineCrossingsReset(top,(*topCorners)[0],(*topCorners)[width]);
+        }
+        LineCrossingsReset(bottom,(*bottomCorners)[0],(*bottomCorners)[width]);
+        LineCrossingsReset(left,(*topCorners)[0],(*bottomCorners)[0]);
+
+        for(int x=0;x<width;x++){
+            vec2 v2_top0 = (*topCorners)[x];
+            vec2 v2_top1 = (*topCorners)[x+1];
+            vec2 v2_bottom0 = (*bottomCorners)[x];
+            vec2 v2_bottom1 = (*bottomCorners)[x+1];
+            LineCrossingsReset(right,v2_top1,v2_bottom1);
+            if(projective && !ProjectiveQuadVisible(M_inv,x,y)){
+                std::swap(left,right);
+                continue;
+            }
+            if(!reflected){
+                srcPolygon.vertices[0].v0 = v2_top0;
+                srcPolygon.vertices[1].v0 = v2_bottom0;
+                srcPolygon.vertices[2].v0 = v2_bottom1;
+                srcPolygon.vertices[3].v0 = v2_top1;
+                crossings[0] = left;
+                crossings[1] = bottom;
+                crossings[2] = right;
+                crossings[3] = top;
+            }else{
+                srcPolygon.vertices[0].v0 = v2_top0;
+                srcPolygon.vertices[1].v0 = v2_top1;
+                srcPolygon.vertices[2].v0 = v2_bottom1;
+                srcPolygon.vertices[3].v0 = v2_bottom0;
+                crossings[0] = top;
+                crossings[1] = right;
+                crossings[2] = bottom;
+                crossings[3] = left;
+            }
+
+            SrcPolygonInitEdges(&srcPolygon);
+            InitPixels();
+            if(!BisectAndVerifyPixels()){
+                fail_vector.push_back(S::ToFloat(v2_top0));
+                fail_errors.push_back(area_error);
+                fail_pixels.push_back(FailPixel{x,y,width,y_begin});
+            }
+            std::swap(left,right);
+        }
+        std::swap(top,bottom);
+        std::swap(topCorners,bottomCorners);
+    }
+    for(int e=0;e<4;e++){
+        crossings[e] = NULL;
+    }
+}
+
+//
+// The source vertices in the pixel, vflag, run along the boundary of the
+// source polygon up to the vertex of edge_bit, whose edge leaves the pixel
+// there. Adds that run in order and returns true, or nothing if the vertex
+// of edge_bit is not in the pixel. Vertices apart from each other in one
+// pixel are separate runs, each added before the crossing its own edge
+// leaves by. A crossing found on an edge within vflagSnap of its first
+// vertex is where the edge before leaves too, it ends the run of that
+// edge's vertex. A vertex on the boundary of the pixel was given to the
+// pixel right or below it, it is added alone before the crossing its edge
+// leaves this pixel by. vflagsAdded collects the vertices added.
+//
+template<typename T>
+bool BisectEngineT<T>::PolygonAddVFlagRun(Polygon *polygon, int vflag, int edge_bit, SrcPolygon *sp, vec2 v_crossing)
+{
+    if(!edge_bit) return false;
+    int last = 0;
+    while(!(edge_bit&(1<<last))) last++;
+    if(!(vflag&edge_bit)){
+        vec2 vertex = sp->vertices[last].v0;
+        vec2 d = v_crossing - vertex;
+        int before = (last+3)&3;
+        if((vflag&(1<<before)) && d.x<=vflagSnap && d.x>=T(0)-vflagSnap && d.y<=vflagSnap && d.y>=T(0)-vflagSnap){
+            last = before;
+        }else{
+            vec2 v_min = vflagPixel + ScalarTraits<T>::FromInt(glm::ivec2(0,-1));
+            vec2 v_max = vflagPixel + ScalarTraits<T>::FromInt(glm::ivec2(1,0));
+            if(vertex.x<v_min.x || vertex.x>v_max.x || vertex.y<v_min.y || vertex.y>v_max.y) return false;
+            PolygonAddVertex(polygon,sp->vertices[last].v0);
+            vflagsAdded |= edge_bit;
+            return true;
+        }
+    }
+    int first = last;
+    for(int n=0;n<3 && (vflag&(1<<((first+3)&3)));n++){
+        first = (first+3)&3;
+    }
+    for(int v=first;;v=(v+1)&3){
+        PolygonAddVertex(polygon,sp->vertices[v].v0);
+        vflagsAdded |= 1<<v;
+        if(v==last) break;
+    }
+    return true;
+}
+
+//
+// A corner of the pixel inside the source polygon can stand for the
+// crossing where an edge leaves, when the end of the edge lies within
+// vflagSnap of the corner and rounding has put the corner inside. Adds the
+// run of the vertex of that edge before the corner, once the first
+// drawing of the pixel has lost it.
+//
+template<typename T>
+bool BisectEngineT<T>::PolygonAddVFlagCorner(Polygon *polygon, int vflag, SrcPolygon *sp, vec2 v_corner)
+{
+    if(vflagSnap==T(0)) return false;
+    for(int v=0;v<4;v++){
+        if(!(vflag&~vflagsAdded&(1<<v))) continue;
+        vec2 d = sp->vertices[(v+1)&3].v0 - v_corner;
+        if(d.x<=vflagSnap && d.x>=T(0)-vflagSnap && d.y<=vflagSnap && d.y>=T(0)-vflagSnap){
+            return PolygonAddVFlagRun(polygon, vflag, 1<<v, sp, v_corner);
+        }
+    }
+    return false;
+}
+
+template<typename T>
+void BisectEngineT<T>::PolygonAddMultiVFlag(Polygon *polygon, int vflag, SrcPolygon *sp){
+    switch(vflag){
+    case 0b0000:
+        return;
+    case 0b0011:
+        PolygonAddVertex(polygon,sp->vertices[0].v0);
+        PolygonAddVertex(polygon,sp->vertices[1].v0);
+        return;
+    case 0b0110:
+        PolygonAddVertex(polygon,sp->vertices[1].v0);
+        PolygonAddVertex(polygon,sp->vertices[2].v0);
+        return;
+    case 0b0111:
+        PolygonAddVertex(polygon,sp->vertices[0].v0);
+        PolygonAddVertex(polygon,sp->vertices[1].v0);
+        PolygonAddVertex(polygon,sp->vertices[2].v0);
+        return;
+    case 0b1001:
+        PolygonAddVertex(polygon,sp->vertices[3].v0);
+        PolygonAddVertex(polygon,sp->vertices[0].v0);
+        return;
+    case 0b1011:
+        PolygonAddVertex(polygon,sp->vertices[3].v0);
+        PolygonAddVertex(polygon,sp->vertices[0].v0);
+        PolygonAddVertex(polygon,sp->vertices[1].v0);
+        return;
+    case 0b1100:
+        PolygonAddVertex(polygon,sp->vertices[2].v0);
+        PolygonAddVertex(polygon,sp->vertices[3].v0);
+        return;
+    case 0b1101:
+        PolygonAddVertex(polygon,sp->vertices[2].v0);
+        PolygonAddVertex(polygon,sp->vertices[3].v0);
+        PolygonAddVertex(polygon,sp->vertices[0].v0);
+        return;
+    case 0b1110:
+        PolygonAddVertex(polygon,sp->vertices[1].v0);
+        PolygonAddVertex(polygon,sp->vertices[2].v0);
+        PolygonAddVertex(polygon,sp->vertices[3].v0);
+        return;
+    }
+}
+
+template<typename T>
+void BisectEngineT<T>::PolygonAddEdgeForward(Polygon *polygon, PixelEdge *edge)
+{
+    switch(edge->code){
+    case 0:
+        if(edge->inside_ends[0]==0b1111){
+            PolygonAddVertex(polygon,edge->v_ends[0]);
+        }
+        break;
+    case 1:
+        PolygonAddVertex(polygon,edge->v_ends[0]);
+        PolygonAddVertex(polygon,edge->v_edge[1]);
+        break;
+    case 2:
+        PolygonAddVertex(polygon,edge->v_edge[0]);
+        break;
+    case 3:
+        PolygonAddVertex(polygon,edge->v_edge[0]);
+        PolygonAddVertex(polygon,edge->v_edge[1]);
+        break;
+    }
+}
+
+template<typename T>
+void BisectEngineT<T>::PolygonAddEdgeReverse(Polygon *polygon, PixelEdge *edge)
+{
+    switch(edge->code){
+    case 0:
+        if(edge->inside_ends[1]==0b1111){
+            PolygonAddVertex(polygon,edge->v_ends[1]);
+        }
+        break;
+    case 1:
+        PolygonAddVertex(polygon,edge->v_edge[1]);
+        break;
+    case 2:
+        PolygonAddVertex(polygon,edge->v_ends[1]);
+        PolygonAddVertex(polygon,edge->v_edge[0]);
+        break;
+    case 3:
+        PolygonAddVertex(polygon,edge->v_edge[1]);
+        PolygonAddVertex(polygon,edge->v_edge[0]);
+        break;
+    }
+}
+
+template<typename T>
+bool BisectEngineT<T>::PolygonAddEdgeVFlagForward(Polygon *polygon, PixelEdge *edge, int vflag, SrcPolygon *sp)
+{
+    bool run = false;
+    switch(edge->code){
+    case 0:
+        if(edge->inside_ends[0]==0b1111){
+            run = PolygonAddVFlagCorner(polygon, vflag, sp, edge->v_ends[0]);
+            PolygonAddVertex(polygon,edge->v_ends[0]);
+        }
+        break;
+    case 1:
+        run = PolygonAddVFlagCorner(polygon, vflag, sp, edge->v_ends[0]);
+        PolygonAddVertex(polygon,edge->v_ends[0]);
+        PolygonAddVertex(polygon,edge->v_edge[1]);
+        break;
+    case 2:
+        run = PolygonAddVFlagRun(polygon, vflag, edge->vflag_edge[0], sp, edge->v_edge[0]);
+        PolygonAddVertex(polygon,edge->v_edge[0]);
+        break;
+    case 3:
+        run = PolygonAddVFlagRun(polygon, vflag, edge->vflag_edge[0], sp, edge->v_edge[0]);
+        PolygonAddVertex(polygon,edge->v_edge[0]);
+        PolygonAddVertex(polygon,edge->v_edge[1]);
+        break;
+    }
+    return run;
+}
+
+template<typename T>
+bool BisectEngineT<T>::PolygonAddEdgeVFlagReverse(Polygon *polygon, PixelEdge *edge, int vflag, SrcPolygon *sp)
+{
+    bool run = false;
+    switch(edge->code){
+    case 0:
+        if(edge->inside_ends[1]==0b1111){
+            run = PolygonAddVFlagCorner(polygon, vflag, sp, edge->v_ends[1]);
+            PolygonAddVertex(polygon,edge->v_ends[1]);
+        }
+        break;
+    case 1:
+        run = PolygonAddVFlagRun(polygon, vflag, edge->vflag_edge[1], sp, edge->v_edge[1]);
+        PolygonAddVertex(polygon,edge->v_edge[1]);
+        break;
+    case 2:
+        run = PolygonAddVFlagCorner(polygon, vflag, sp, edge->v_ends[1]);
+        PolygonAddVertex(polygon,edge->v_ends[1]);
+        PolygonAddVertex(polygon,edge->v_edge[0]);
+        break;
+    case 3:
+        run = PolygonAddVFlagRun(polygon, vflag, edge->vflag_edge[1], sp, edge->v_edge[1]);
+        PolygonAddVertex(polygon,edge->v_edge[1]);
+        PolygonAddVertex(polygon,edge->v_edge[0]);
+        break;
+    }
+    return run;
+}
+
+
+template class BisectEngineT<float>;
+template class BisectEngineT<double>;
+template class BisectEngineT<fixed32>;
@@ -0,0 +1,182 @@
+#ifndef BISECTENGINE_H
+#define BISECTENGINE_H
+
+#include "bisect.h"
+#include "arena.h"
+#include <vector>
+
+//
+// the area of the source polygon that falls in one source pixel
+//
+struct PixelCoverage {
+    glm::ivec2 i2_pixel; // column and row of the source pixel
+    float area;
+};
+
+//
+// n source pixels of one row, from i2_pixel on, inside the source polygon
+//
+struct CoverageSpan {
+    glm::ivec2 i2_pixel;
+    int n;
+};
+
+//
+// the paths a pixel of the grid can take, see ClassifyPixel
+//
+#define PIXEL_PARTIAL 0  // bisected and clipped
+#define PIXEL_COVERED 1  // inside the source polygon, area 1
+#define PIXEL_EMPTY   2  // outside one edge of the source polygon, area 0
+#define PIXEL_PATHS   3
+
+//
+// The source pixels of a grid row that the edges of the source polygon
+// pass through, [x0,x1] on the left and [x2,x3] on the right. The pixels
+// in between are covered, the ones outside are empty. A span with nothing
+// in it ends before it starts.
+//
+struct RowSpan {
+    int x0, x1;
+    int x2, x3;
+};
+
+//
+// The destination pixel of a failure, and the width and first row of the
+// sweep it was verified in. The shared edge sweep starts afresh on that
+// row and a shared line is as long as the sweep is wide, both are needed
+// to verify the pixel again the same way.
+//
+struct FailPixel {
+    int x, y;
+    int width;
+    int y_begin;
+};
+
+//
+// One row of pixel edges as dense arrays, edge i at index i and its two
+// crossings at 2*i and 2*i+1. The ends of an edge are lattice vertices,
+// their positions follow from the index and their inside flags are in
+// vertexInside, so only what the bisection adds is kept. The crossings
+// are only written for edges with a code other than 0.
+//
+template<typename T>
+struct PixelEdgeRowT {
+    int *code;
+    typename ScalarTraits<T>::vec2 *v_edge;
+    int *inside_edge;
+    int *vflag_edge;
+};
+
+// grids from this size on are walked along the edges of the source
+// polygon instead of testing every vertex of the lattice
+#define WALK_GRID_SIZE 8
+
+// a crossing this close to a source vertex can stand for that vertex when
+// the polygon of a pixel has lost a run of source vertices, see BisectPixel
+#define VFLAG_SNAP 1e-4f
+
+//
+// The scratch state and compute path of the bisection algorithm.
+// Holds no GUI or GL state so it can run on headless machines.
+//
+// The inside flags of the lattice and the vertex flags of the pixels are
+// grids stored row after row without padding. The pixels are swept in
+// raster order and an edge is read back at most one row after it was
+// bisected, so only two rows of horizontal edges and one row of vertical
+// edges are kept, whatever the size of the footprint. The edges of the
+// pixel being bisected are unpacked into PixelEdge structs on the stack.
+// Footprints of up to GRID_SIZE pixels use the fixed arrays, larger ones
+// are carved from the arena of the engine.
+//
+// The clipping runs on the scalar type T, the transform and the results
+// (areas, failures, coverage) are float whatever T is. BisectEngine is
+// the float engine, bisectengine.cpp instantiates float, double and
+// fixed32.
+//
+
+template<typename T>
+class BisectEngineT
+{
+public:
+    typedef typename ScalarTraits<T>::vec2 vec2;
+    typedef SrcPolygonT<T> SrcPolygon;
+    typedef PixelEdgeT<T> PixelEdge;
+    typedef PixelEdgeRowT<T> PixelEdgeRow;
+    typedef PolygonT<T> Polygon;
+    typedef LineCrossingsT<T> LineCrossings;
+    BisectEngineT();
+    ~BisectEngineT();
+    void CopySettings(const BisectEngineT *engine);
+    SrcPolygon srcPolygon;
+    int *vertexInside;           // Npixely+1 rows of Npixelx+1 inside flags
+    PixelEdgeRow xEdgeRows[2];   // the horizontal edges of lattice row y in xEdgeRows[y&1]
+    PixelEdgeRow yEdgeRow;       // the vertical edges of the pixel row being swept
+    int  *pixelVFlags;           // Npixely rows of Npixelx
+    RowSpan *rowSpans;           // Npixely rows, valid when walked is set
+    Polygon polygon;
+    int Npixelx;
+    int Npixely;
+    int grid_size;
+    glm::ivec2 i2_v0;    // top left corner of the pixel grid
+    glm::vec2 v2_dsrcx;
+    glm::vec2 v2_dsrcy;
+    float area_error;
+    std::vector<glm::vec2> fail_vector;  // v2_src00 of the failed pixels
+    std::vector<float> fail_errors;      // and their area_error
+    std::vector<FailPixel> fail_pixels;  // and their destination pixel
+    std::vector<PixelCoverage> coverage;
+    std::vector<CoverageSpan> coveredSpans;  // filled instead of coverage when cover_spans is set
+    bool share_edges;    // sweep rows sharing the edges between neighbours
+    bool edge_walk;      // allow InitPixels to walk large grids
+    bool cover_spans;    // BisectAndCoverPixels leaves the covered runs of walked rows in coveredSpans
+    bool walked;         // the last grid was walked, see rowSpans
+    LineCrossings *crossings[4];
+    long long path_counts[PIXEL_PATHS];  // pixels that took each path
+    void InitPolygon(glm::vec2 v2_src00, glm::vec2 v2_dsrcx, glm::vec2 v2_dsrcy);
+    bool InitQuad(glm::mat3 &M_inv, int x, int y);
+    void InitPixels(void);
+    void BisectPixel(int x, int y, bool top_fresh=false, bool left_fresh=false);
+    int ClassifyPixel(int x, int y);
+    bool BisectAndVerifyPixels(void);
+    void BisectAndCoverPixels(void);
+    void InitTransform(glm::mat3 &M_inv);
+    void EmulateTransform(int width, int height, glm::mat3 &M_inv);
+    void EmulateTransformRows(int width, int y_begin, int y_end, glm::mat3 &M_inv);
+    bool VerifySharedPixel(glm::mat3 &M_inv, FailPixel pixel);
+    int *VertexInsideAt(int x, int y){ return &vertexInside[y*(Npixelx+1)+x]; }
+    vec2 VertexAt(int x, int y){ return ScalarTraits<T>::FromInt(glm::ivec2(i2_v0.x+x,i2_v0.y-y)); }
+    PixelEdgeRow *XEdgeRow(int y){ return &xEdgeRows[y&1]; }
+    int *PixelVFlagAt(int x, int y){ return &pixelVFlags[y*Npixelx+x]; }
+private:
+    int fixedInside[(GRID_SIZE+1)*(GRID_SIZE+1)];
+    int fixedEdgeCodes[3*(GRID_SIZE+1)];
+    vec2 fixedEdgeCrossings[6*(GRID_SIZE+1)];
+    int fixedEdgeInside[6*(GRID_SIZE+1)];
+    int fixedEdgeVFlags[6*(GRID_SIZE+1)];
+    int fixedVFlags[GRID_SIZE*GRID_SIZE];
+    RowSpan fixedRowSpans[GRID_SIZE];
+    ScratchArena arena;
+    void InitScratch(void);
+    void InitEdgeRows(int stride, int *codes, vec2 *crossings, int *inside, int *vflags);
+    void InitPixelsWalk(glm::ivec2 *i2_src);
+    float VisitPixel(int x, int y, bool top_fresh, bool left_fresh);
+    bool RowSpanVisited(int x, int y);
+    std::vector<vec2> corners[2];
+    LineCrossings rowLines[2];
+    LineCrossings colLines[2];
+    void EmulateTransformRowsShared(int width, int y_begin, int y_end, glm::mat3 &M_inv);
+    int vflagsAdded;     // the source vertices put into the polygon of the pixel
+    T vflagSnap;         // how close a crossing has to be to stand for a vertex
+    vec2 vflagPixel;     // top left corner of the pixel being drawn
+    bool PolygonAddVFlagRun(Polygon *polygon, int vflag, int edge_bit, SrcPolygon *sp, vec2 v_crossing);
+    bool PolygonAddVFlagCorner(Polygon *polygon, int vflag, SrcPolygon *sp, vec2 v_corner);
+    void PolygonAddMultiVFlag(Polygon *polygon, int vflag, SrcPolygon *sp);
+    void PolygonAddEdgeForward(Polygon *polygon, PixelEdge *edge);
+    void PolygonAddEdgeReverse(Polygon *polygon, PixelEdge *edge);
+    bool PolygonAddEdgeVFlagForward(Polygon *polygon, PixelEdge *edge, int vflag, SrcPolygon *sp);
+    bool PolygonAddEdgeVFlagReverse(Polygon *polygon, PixelEdge *edge, int vflag, SrcPolygon *sp);
+};
+
+typedef BisectEngineT<float> BisectEngine;
+
+#endif // BISECTENGINE_H
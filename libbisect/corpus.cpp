@@ -0,0 +1,283 @@
+#include "corpus.h"
+#include "emulate.h"
+#include <algorithm>
+#include <atomic>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+void CorpusBuilderAddTransform(CorpusBuilder *builder, glm::mat3 &M_inv,
+                               glm::vec2 v2_dsrcx, glm::vec2 v2_dsrcy,
+                               const char *scalar, bool share_edges)
+{
+    CorpusTransform transform;
+    memset(&transform,0,sizeof(transform));
+    for(int c=0;c<3;c++){
+        for(int r=0;r<3;r++){
+            transform.M_inv[c*3+r] = M_inv[c][r];
+        }
+    }
+    transform.dsrcx[0] = v2_dsrcx.x;
+    transform.dsrcx[1] = v2_dsrcx.y;
+    transform.dsrcy[0] = v2_dsrcy.x;
+    transform.dsrcy[1] = v2_dsrcy.y;
+    // the memset leaves the name terminated
+    strncpy(transform.scalar,scalar,sizeof(transform.scalar) - 1);
+    transform.share_edges = share_edges ? 1 : 0;
+    transform.first_record = builder->records.size();
+    transform.n_records = 0;
+    builder->transforms.push_back(transform);
+}
+
+void CorpusBuilderAddRecord(CorpusBuilder *builder, glm::vec2 v2_src00, float area_error,
+                            FailPixel pixel)
+{
+    CorpusRecord record;
+    memset(&record,0,sizeof(record));
+    record.src00[0] = v2_src00.x;
+    record.src00[1] = v2_src00.y;
+    record.area_error = area_error;
+    record.transform = (uint32_t)(builder->transforms.size() - 1);
+    record.x = pixel.x;
+    record.y = pixel.y;
+    record.width = pixel.width;
+    record.y_begin = pixel.y_begin;
+    builder->records.push_back(record);
+    builder->transforms.back().n_records++;
+}
+
+template<typename T>
+void CorpusBuilderAddSweep(CorpusBuilder *builder, BisectEngineT<T> *engine, glm::mat3 &M_inv)
+{
+    CorpusBuilderAddTransform(builder,M_inv,engine->v2_dsrcx,engine->v2_dsrcy,
+                              ScalarTraits<T>::Name(),engine->share_edges);
+    for(size_t i=0;i<engine->fail_vector.size();i++){
+        CorpusBuilderAddRecord(builder,engine->fail_vector[i],engine->fail_errors[i],
+                               engine->fail_pixels[i]);
+    }
+}
+
+bool CorpusBuilderWrite(CorpusBuilder *builder, const char *filename)
+{
+    CorpusHeader header;
+    memset(&header,0,sizeof(header));
+    memcpy(header.magic,CORPUS_MAGIC,sizeof(header.magic));
+    header.version = CORPUS_VERSION;
+    header.header_size = sizeof(CorpusHeader);
+    header.n_transforms = builder->transforms.size();
+    header.n_records = builder->records.size();
+    header.transforms_offset = sizeof(CorpusHeader);
+    header.records_offset = header.transforms_offset + header.n_transforms*sizeof(CorpusTransform);
+
+    FILE *f = fopen(filename,"wb");
+    if(!f){
+        fprintf(stderr,"unable to create %s\n",filename);
+        return false;
+    }
+    bool ok = fwrite(&header,sizeof(header),1,f)==1;
+    if(ok && header.n_transforms){
+        ok = fwrite(builder->transforms.data(),sizeof(CorpusTransform),header.n_transforms,f)
+                ==header.n_transforms;
+    }
+    if(ok && header.n_records){
+        ok = fwrite(builder->records.data(),sizeof(CorpusRecord),header.n_records,f)
+                ==header.n_records;
+    }
+    if(fclose(f)!=0) ok = false;
+    if(!ok){
+        fprintf(stderr,"unable to write %s\n",filename);
+    }
+    return ok;
+}
+
+//
+// a table of n entries of `size` bytes at offset has to lie in the file
+//
+static bool CorpusTableFits(size_t file_size, uint64_t offset, uint64_t n, size_t size, size_t align)
+{
+    if(offset%align || offset>file_size) return false;
+    return n<=(file_size - offset)/size;
+}
+
+bool CorpusOpen(Corpus *corpus, const char *filename)
+{
+    memset(corpus,0,sizeof(*corpus));
+    int fd = open(filename,O_RDONLY);
+    if(fd<0){
+        return false;
+    }
+    struct stat st;
+    if(fstat(fd,&st)!=0 || (size_t)st.st_size<sizeof(CorpusHeader)){
+        fprintf(stderr,"%s is not a bisect corpus\n",filename);
+        close(fd);
+        return false;
+    }
+    size_t size = (size_t)st.st_size;
+    void *map = mmap(NULL,size,PROT_READ,MAP_PRIVATE,fd,0);
+    // the mapping keeps the file open
+    close(fd);
+    if(map==MAP_FAILED){
+        fprintf(stderr,"unable to map %s\n",filename);
+        return false;
+    }
+
+    const CorpusHeader *header = (const CorpusHeader*)map;
+    if(memcmp(header->magic,CORPUS_MAGIC,sizeof(header->magic))
+            || header->header_size!=sizeof(CorpusHeader)){
+        fprintf(stderr,"%s is not a bisect corpus\n",filename);
+        munmap(map,size);
+        return false;
+    }
+    if(header->version!=CORPUS_VERSION){
+        fprintf(stderr,"%s is corpus version %u, expected %u\n",filename,
+                header->version,CORPUS_VERSION);
+        munmap(map,size);
+        return false;
+    }
+    if(!CorpusTableFits(size,header->transforms_offset,header->n_transforms,
+                        sizeof(CorpusTransform),alignof(CorpusTransform))
+            || !CorpusTableFits(size,header->records_offset,header->n_records,
+                                sizeof(CorpusRecord),alignof(CorpusRecord))){
+        fprintf(stderr,"%s is truncated\n",filename);
+        munmap(map,size);
+        return false;
+    }
+
+    corpus->map = map;
+    corpus->size = size;
+    corpus->header = header;
+    corpus->transforms = (const CorpusTransform*)((const char*)map + header->transforms_offset);
+    corpus->records = (const CorpusRecord*)((const char*)map + header->records_offset);
+    corpus->n_transforms = header->n_transforms;
+    corpus->n_records = header->n_records;
+    return true;
+}
+
+void CorpusClose(Corpus *corpus)
+{
+    if(corpus->map){
+        munmap(corpus->map,corpus->size);
+    }
+    memset(corpus,0,sizeof(*corpus));
+}
+
+glm::mat3 CorpusTransformMatrix(const CorpusTransform *transform)
+{
+    glm::mat3 M_inv;
+    for(int c=0;c<3;c++){
+        for(int r=0;r<3;r++){
+            M_inv[c][r] = transform->M_inv[c*3+r];
+        }
+    }
+    return M_inv;
+}
+
+const CorpusTransform *CorpusRecordTransform(const Corpus *corpus, uint64_t i)
+{
+    uint32_t t = corpus->records[i].transform;
+    if(t>=corpus->n_transforms){
+        fprintf(stderr,"corpus record %llu has no transform\n",(unsigned long long)i);
+        return NULL;
+    }
+    return &corpus->transforms[t];
+}
+
+const char *CorpusScalar(const Corpus *corpus)
+{
+    if(!corpus->n_transforms) return NULL;
+    const char *names[3] = {ScalarTraits<float>::Name(),ScalarTraits<double>::Name(),
+                            ScalarTraits<fixed32>::Name()};
+    for(int i=0;i<3;i++){
+        if(!strncmp(corpus->transforms[0].scalar,names[i],sizeof(corpus->transforms[0].scalar))){
+            return names[i];
+        }
+    }
+    return NULL;
+}
+
+template<typename T>
+bool CorpusReplayRecord(BisectEngineT<T> *engine, const Corpus *corpus, uint64_t i)
+{
+    const CorpusRecord *record = &corpus->records[i];
+    const CorpusTransform *transform = CorpusRecordTransform(corpus,i);
+    if(!transform){
+        engine->area_error = 0.0f;
+        return false;
+    }
+    engine->v2_dsrcx = glm::vec2(transform->dsrcx[0],transform->dsrcx[1]);
+    engine->v2_dsrcy = glm::vec2(transform->dsrcy[0],transform->dsrcy[1]);
+    engine->share_edges = transform->share_edges!=0;
+    glm::vec2 v2_src00(record->src00[0],record->src00[1]);
+    glm::mat3 M_inv = CorpusTransformMatrix(transform);
+    if(engine->share_edges){
+        FailPixel pixel = {record->x,record->y,record->width,record->y_begin};
+        return engine->VerifySharedPixel(M_inv,pixel);
+    }
+    if(TransformProjective(M_inv)){
+        if(!engine->InitQuad(M_inv,record->x,record->y)){
+            engine->area_error = 0.0f;
+            return false;
+        }
+    }else{
+        engine->InitPolygon(v2_src00,engine->v2_dsrcx,engine->v2_dsrcy);
+    }
+    engine->InitPixels();
+    return engine->BisectAndVerifyPixels();
+}
+
+#define CORPUS_CHUNK 4096
+
+template<typename T>
+void CorpusReplayParallel(const Corpus *corpus, uint64_t first, uint64_t count, int n_threads,
+                          std::vector<uint64_t> *still_failing)
+{
+    still_failing->clear();
+    if(first>=corpus->n_records) return;
+    if(count>corpus->n_records - first) count = corpus->n_records - first;
+    n_threads = EmulateThreadCount(n_threads);
+    uint64_t n_chunks = (count + CORPUS_CHUNK - 1)/CORPUS_CHUNK;
+    if((uint64_t)n_threads>n_chunks) n_threads = (int)n_chunks;
+    if(n_threads<1) n_threads = 1;
+
+    // every chunk keeps its failures so they can be joined in order
+    std::vector<std::vector<uint64_t>> chunk_fails(n_chunks);
+    std::atomic<uint64_t> next_chunk(0);
+    auto worker = [&](){
+        BisectEngineT<T> *engine = new BisectEngineT<T>;
+        uint64_t chunk;
+        while((chunk = next_chunk.fetch_add(1))<n_chunks){
+            uint64_t begin = first + chunk*CORPUS_CHUNK;
+            uint64_t end = std::min(begin + CORPUS_CHUNK,first + count);
+            for(uint64_t i=begin;i<end;i++){
+                if(!CorpusReplayRecord(engine,corpus,i)){
+                    chunk_fails[chunk].push_back(i);
+                }
+            }
+        }
+        delete engine;
+    };
+    std::vector<std::thread> threads;
+    for(int t=1;t<n_threads;t++){
+        threads.push_back(std::thread(worker));
+    }
+    worker();
+    for(size_t t=0;t<threads.size();t++){
+        threads[t].join();
+    }
+    for(uint64_t c=0;c<n_chunks;c++){
+        still_failing->insert(still_failing->end(),chunk_fails[c].begin(),chunk_fails[c].end());
+    }
+}
+
+#define CORPUS_INSTANTIATE(T) \
+    template void CorpusBuilderAddSweep<T>(CorpusBuilder*, BisectEngineT<T>*, glm::mat3&); \
+    template bool CorpusReplayRecord<T>(BisectEngineT<T>*, const Corpus*, uint64_t); \
+    template void CorpusReplayParallel<T>(const Corpus*, uint64_t, uint64_t, int, std::vector<uint64_t>*);
+
+CORPUS_INSTANTIATE(float)
+CORPUS_INSTANTIATE(double)
+CORPUS_INSTANTIATE(fixed32)
@@ -0,0 +1,117 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include "bisectengine.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+//
+// A file of recorded failures to replay. It holds the transforms, each
+// with its destination to source matrix, its steps v2_dsrcx and v2_dsrcy
+// and the scalar type and sweep of the engine that failed on it, and the
+// failed destination pixels of every transform, each with its v2_src00
+// and the area_error seen when it was recorded.
+//
+// The file is the header, the table of transforms and the table of
+// records, in the byte order of the machine that wrote it. The records of
+// a transform are contiguous and the transform holds the index of its
+// first one, so the transforms are the index of the file. CorpusOpen maps
+// the file and the tables are read in place, any record is reached
+// without a read call.
+//
+#define CORPUS_MAGIC "BISECTCP"
+#define CORPUS_VERSION 2
+
+struct CorpusHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;         // sizeof(CorpusHeader)
+    uint64_t n_transforms;
+    uint64_t n_records;
+    uint64_t transforms_offset;   // from the start of the file
+    uint64_t records_offset;
+};
+
+struct CorpusTransform {
+    float M_inv[9];               // column major as glm::mat3
+    float dsrcx[2];
+    float dsrcy[2];
+    char scalar[8];               // ScalarTraits<T>::Name() of the engine
+    uint32_t share_edges;         // 1 if it swept with shared edges
+    uint64_t first_record;
+    uint64_t n_records;
+};
+
+struct CorpusRecord {
+    float src00[2];
+    float area_error;
+    uint32_t transform;
+    int32_t x, y;                 // the destination pixel
+    int32_t width;                // the width and first row of its sweep,
+    int32_t y_begin;              // see FailPixel
+};
+
+//
+// failures collected in memory before they are written
+//
+struct CorpusBuilder {
+    std::vector<CorpusTransform> transforms;
+    std::vector<CorpusRecord> records;
+};
+
+// starts a new transform, the records added after it belong to it
+void CorpusBuilderAddTransform(CorpusBuilder *builder, glm::mat3 &M_inv,
+                               glm::vec2 v2_dsrcx, glm::vec2 v2_dsrcy,
+                               const char *scalar, bool share_edges);
+void CorpusBuilderAddRecord(CorpusBuilder *builder, glm::vec2 v2_src00, float area_error,
+                            FailPixel pixel);
+// the transform of the engine's last sweep and all its failures
+template<typename T>
+void CorpusBuilderAddSweep(CorpusBuilder *builder, BisectEngineT<T> *engine, glm::mat3 &M_inv);
+bool CorpusBuilderWrite(CorpusBuilder *builder, const char *filename);
+
+//
+// a mapped corpus, the tables point into the mapping
+//
+struct Corpus {
+    void *map;
+    size_t size;
+    const CorpusHeader *header;
+    const CorpusTransform *transforms;
+    const CorpusRecord *records;
+    uint64_t n_transforms;
+    uint64_t n_records;
+};
+
+bool CorpusOpen(Corpus *corpus, const char *filename);
+void CorpusClose(Corpus *corpus);
+
+glm::mat3 CorpusTransformMatrix(const CorpusTransform *transform);
+// the transform of record i, NULL if the record does not name one
+const CorpusTransform *CorpusRecordTransform(const Corpus *corpus, uint64_t i);
+// the scalar type of the engine that failed on the first transform, NULL
+// if the corpus is empty or the name is not one of ScalarTraits
+const char *CorpusScalar(const Corpus *corpus);
+
+//
+// Bisects record i again the way it was swept: with the steps it was
+// recorded with, with the quad of its destination pixel if the transform
+// is projective, and with its neighbours if the sweep shared the edges,
+// see VerifySharedPixel. The engine takes the share_edges of the
+// transform, the scalar type is T whatever was recorded. Returns false if
+// it still fails, engine->area_error is the new error.
+//
+template<typename T>
+bool CorpusReplayRecord(BisectEngineT<T> *engine, const Corpus *corpus, uint64_t i);
+
+//
+// Replays the records first to first+count-1 on n_threads threads, one
+// engine per thread. The indices of the ones that still fail are returned
+// in still_failing in ascending order. n_threads<=0 uses all the cores.
+//
+template<typename T>
+void CorpusReplayParallel(const Corpus *corpus, uint64_t first, uint64_t count, int n_threads,
+                          std::vector<uint64_t> *still_failing);
+
+#endif // CORPUS_H
@@ -0,0 +1,93 @@
+#include "counters.h"
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+
+// the fields are all long long, the blocks are added as arrays of them
+#define COUNTER_FIELDS (sizeof(BisectCounters)/sizeof(long long))
+static_assert(sizeof(BisectCounters)%sizeof(long long)==0,"BisectCounters holds only long long");
+
+static std::mutex counters_mutex;
+static BisectCounters counters_exited;
+
+static void BisectCountersAdd(BisectCounters *sum, const BisectCounters *counters)
+{
+    long long *s = (long long*)sum;
+    const long long *c = (const long long*)counters;
+    for(size_t i=0;i<COUNTER_FIELDS;i++){
+        s[i] += c[i];
+    }
+}
+
+//
+// the block of one thread, added to counters_exited when the thread exits
+//
+struct CounterBlock {
+    BisectCounters counters;
+    CounterBlock(){ memset(&counters,0,sizeof(counters)); }
+    ~CounterBlock(){
+        std::lock_guard<std::mutex> lock(counters_mutex);
+        BisectCountersAdd(&counters_exited,&counters);
+    }
+};
+
+static thread_local CounterBlock counter_block;
+
+BisectCounters *BisectCountersThread(void)
+{
+    return &counter_block.counters;
+}
+
+void BisectCountersTotal(BisectCounters *total)
+{
+    std::lock_guard<std::mutex> lock(counters_mutex);
+    *total = counters_exited;
+    BisectCountersAdd(total,&counter_block.counters);
+}
+
+static void WriteArray(FILE *f, const char *name, const long long *values, int n)
+{
+    fprintf(f,"  \"%s\": [",name);
+    for(int i=0;i<n;i++){
+        fprintf(f,"%s%lld",i ? ", " : "",values[i]);
+    }
+    fprintf(f,"],\n");
+}
+
+bool BisectCountersWriteJSON(const BisectCounters *counters, const char *filename)
+{
+    FILE *f = fopen(filename,"w");
+    if(!f){
+        fprintf(stderr,"unable to create %s\n",filename);
+        return false;
+    }
+#ifdef BISECT_COUNTERS
+    const char *enabled = "true";
+#else
+    const char *enabled = "false";
+#endif
+    fprintf(f,"{\n");
+    fprintf(f,"  \"enabled\": %s,\n",enabled);
+    fprintf(f,"  \"init_pixels\": %lld,\n",counters->init_pixels);
+    fprintf(f,"  \"walked_grids\": %lld,\n",counters->walked_grids);
+    fprintf(f,"  \"lattice_points\": %lld,\n",counters->lattice_points);
+    fprintf(f,"  \"pixels_bisected\": %lld,\n",counters->pixels_bisected);
+    WriteArray(f,"edge_codes",counters->edge_codes,4);
+    fprintf(f,"  \"intersections\": %lld,\n",counters->intersections);
+    fprintf(f,"  \"intersection_fallbacks\": %lld,\n",counters->intersection_fallbacks);
+    fprintf(f,"  \"axis_crossings\": %lld,\n",counters->axis_crossings);
+    fprintf(f,"  \"axis_fallbacks\": %lld,\n",counters->axis_fallbacks);
+    // indexed by the vertex flags and by the vertex count
+    WriteArray(f,"pixel_vflags",counters->pixel_vflags,16);
+    fprintf(f,"  \"polygon_n\": [");
+    for(int i=0;i<COUNTER_POLYGON_N;i++){
+        fprintf(f,"%s%lld",i ? ", " : "",counters->polygon_n[i]);
+    }
+    fprintf(f,"]\n}\n");
+    bool ok = !ferror(f);
+    if(fclose(f)!=0) ok = false;
+    if(!ok){
+        fprintf(stderr,"unable to write %s\n",filename);
+    }
+    return ok;
+}
@@ -0,0 +1,43 @@
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+//
+// Counters of the hot paths of the engine, to see which cases are worth
+// specialising. The counts are compiled in when BISECT_COUNTERS is defined
+// (qmake CONFIG+=bisect_counters) and BISECT_COUNT is nothing otherwise.
+// Every thread counts into its own block. The block of a thread is added
+// to the total when the thread exits, so the worker threads of a run are
+// in the total once they have been joined.
+//
+#define COUNTER_POLYGON_N 11   // a clipped polygon has at most 10 vertices
+
+struct BisectCounters {
+    long long init_pixels;               // InitPixels calls
+    long long walked_grids;              // of them walked along the source edges
+    long long lattice_points;            // lattice vertices classified against the source edges
+    long long pixels_bisected;           // BisectPixel calls
+    long long edge_codes[4];             // pixel edges bisected, by the code they end in
+    long long intersections;             // general crossing solves
+    long long intersection_fallbacks;    // of them with no finite solution
+    long long axis_crossings;            // crossings of pixel edges read off the slope
+    long long axis_fallbacks;            // of them left to the general solve
+    long long pixel_vflags[16];          // bisected pixels by the source vertices in them
+    long long polygon_n[COUNTER_POLYGON_N];  // clipped polygons by vertex count
+};
+
+// the block of the calling thread
+BisectCounters *BisectCountersThread(void);
+// the sum of the blocks of the exited threads and of the calling thread
+void BisectCountersTotal(BisectCounters *total);
+// writes counters as a JSON object, false if the file can not be written
+bool BisectCountersWriteJSON(const BisectCounters *counters, const char *filename);
+
+#ifdef BISECT_COUNTERS
+#define BISECT_COUNT(field) (BisectCountersThread()->field++)
+#define BISECT_COUNT_N(field,n) (BisectCountersThread()->field += (n))
+#else
+#define BISECT_COUNT(field) ((void)0)
+#define BISECT_COUNT_N(field,n) ((void)0)
+#endif
+
+#endif // COUNTERS_H
@@ -0,0 +1,131 @@
+#include "emulate.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#define EMULATE_CHUNKS 256
+
+int EmulateThreadCount(int n_threads)
+{
+    if(n_threads<=0){
+        n_threads = (int)std::thread::hardware_concurrency();
+        if(n_threads<=0) n_threads = 1;
+    }
+    return n_threads;
+}
+
+void EmulateProgressInit(EmulateProgress *progress)
+{
+    progress->cancel = false;
+    progress->rows_done = 0;
+    progress->failures = NULL;
+    progress->user = NULL;
+}
+
+template<typename T>
+void EmulateTransformParallel(BisectEngineT<T> *engine, int width, int height, glm::mat3 &M_inv, int n_threads,
+                              EmulateProgress *progress)
+{
+    n_threads = EmulateThreadCount(n_threads);
+    engine->InitTransform(M_inv);
+    engine->fail_vector.clear();
+    engine->fail_errors.clear();
+    engine->fail_pixels.clear();
+    for(int i=0;i<PIXEL_PATHS;i++){
+        engine->path_counts[i] = 0;
+    }
+
+    //
+    // the rows are handed out in chunks, many per thread to balance the
+    // load. Each chunk keeps its own failures so they can be joined in
+    // raster order afterwards. The chunks do not depend on the number of
+    // threads, the shared edge sweep starts afresh in every chunk and the
+    // results have to be the same for any thread count.
+    //
+    int rows_per_chunk = (height + EMULATE_CHUNKS - 1)/EMULATE_CHUNKS;
+    if(rows_per_chunk<1) rows_per_chunk = 1;
+    int n_chunks = (height + rows_per_chunk - 1)/rows_per_chunk;
+    if(n_threads>n_chunks) n_threads = n_chunks;
+    if(n_threads<1) n_threads = 1;
+    std::vector<std::vector<glm::vec2>> chunk_fails(n_chunks);
+    std::vector<std::vector<float>> chunk_errors(n_chunks);
+    std::vector<std::vector<FailPixel>> chunk_pixels(n_chunks);
+    std::atomic<int> next_chunk(0);
+
+    //
+    // finished chunks are reported once all the ones before them are,
+    // next_report is the first chunk not reported yet
+    //
+    std::vector<char> chunk_finished(n_chunks,0);
+    int next_report = 0;
+    std::mutex report_mutex;
+    auto report = [&](int chunk){
+        std::lock_guard<std::mutex> lock(report_mutex);
+        chunk_finished[chunk] = 1;
+        while(next_report<n_chunks && chunk_finished[next_report]){
+            int c = next_report++;
+            if(progress->failures && !chunk_fails[c].empty()){
+                progress->failures(progress->user,chunk_fails[c].data(),chunk_errors[c].data(),
+                                   chunk_fails[c].size());
+            }
+            progress->rows_done += glm::min(rows_per_chunk,height - c*rows_per_chunk);
+        }
+    };
+
+    auto worker = [&](BisectEngineT<T> *e){
+        int chunk;
+        while((!progress || !progress->cancel) && (chunk = next_chunk.fetch_add(1))<n_chunks){
+            int y_begin = chunk*rows_per_chunk;
+            int y_end = y_begin + rows_per_chunk;
+            if(y_end>height) y_end = height;
+            e->fail_vector.clear();
+            e->fail_errors.clear();
+            e->fail_pixels.clear();
+            e->EmulateTransformRows(width,y_begin,y_end,M_inv);
+            chunk_fails[chunk].swap(e->fail_vector);
+            chunk_errors[chunk].swap(e->fail_errors);
+            chunk_pixels[chunk].swap(e->fail_pixels);
+            if(progress) report(chunk);
+        }
+    };
+
+    std::vector<BisectEngineT<T>*> engines(n_threads);
+    std::vector<std::thread> threads;
+    engines[0] = engine;
+    for(int t=1;t<n_threads;t++){
+        engines[t] = new BisectEngineT<T>;
+        engines[t]->CopySettings(engine);
+        threads.push_back(std::thread(worker,engines[t]));
+    }
+    worker(engine);
+    for(size_t t=0;t<threads.size();t++){
+        threads[t].join();
+    }
+    for(int t=1;t<n_threads;t++){
+        for(int i=0;i<PIXEL_PATHS;i++){
+            engine->path_counts[i] += engines[t]->path_counts[i];
+        }
+        delete engines[t];
+    }
+
+    // a cancelled sweep keeps the failures it has reported
+    if(progress) n_chunks = next_report;
+    engine->fail_vector.clear();
+    engine->fail_errors.clear();
+    engine->fail_pixels.clear();
+    for(int c=0;c<n_chunks;c++){
+        engine->fail_vector.insert(engine->fail_vector.end(),
+                                   chunk_fails[c].begin(),chunk_fails[c].end());
+        engine->fail_errors.insert(engine->fail_errors.end(),
+                                   chunk_errors[c].begin(),chunk_errors[c].end());
+        engine->fail_pixels.insert(engine->fail_pixels.end(),
+                                   chunk_pixels[c].begin(),chunk_pixels[c].end());
+    }
+}
+
+template void EmulateTransformParallel<float>(BisectEngineT<float>*, int, int, glm::mat3&, int,
+                                               EmulateProgress*);
+template void EmulateTransformParallel<double>(BisectEngineT<double>*, int, int, glm::mat3&, int,
+                                                EmulateProgress*);
+template void EmulateTransformParallel<fixed32>(BisectEngineT<fixed32>*, int, int, glm::mat3&, int,
+                                                 EmulateProgress*);
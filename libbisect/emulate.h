@@ -0,0 +1,46 @@
+#ifndef EMULATE_H
+#define EMULATE_H
+
+#include "bisectengine.h"
+#include <atomic>
+
+//
+// Progress and cancellation of a sweep run in the background. The sweep
+// stops handing out rows once cancel is set. As soon as the rows before
+// them are done, the failures of every finished chunk of rows are passed
+// to failures (if set) in raster order. failures is called on one worker
+// thread at a time and never on two at once. rows_done counts the rows
+// reported so far.
+//
+struct EmulateProgress {
+    std::atomic<bool> cancel;
+    std::atomic<int> rows_done;
+    void (*failures)(void *user, const glm::vec2 *v2_src00, const float *area_errors, size_t n);
+    void *user;
+};
+
+void EmulateProgressInit(EmulateProgress *progress);
+
+//
+// Row parallel EmulateTransform. Every worker thread gets its own
+// BisectEngine as scratch context, `engine` is used by the first one.
+// The rows are swept in chunks that depend on the height alone. On return
+// engine->v2_dsrcx, v2_dsrcy, fail_vector, fail_errors and fail_pixels
+// hold the failures of every chunk in raster order, the same for any
+// n_threads, n_threads<=0 uses all the cores. The workers take the
+// settings of engine, see CopySettings, so share_edges selects the shared
+// edge row sweep in all of them. Without it the results are those of
+// engine->EmulateTransform(width,height,M_inv). The shared sweep starts
+// afresh at the first row of every chunk, so its results are those of
+// one EmulateTransformRows per chunk and differ from a single shared
+// sweep over all the rows. Instantiated for the float, double and
+// fixed32 engines. With progress, the failures on return are the ones
+// reported, which is all of them unless the sweep was cancelled.
+//
+template<typename T>
+void EmulateTransformParallel(BisectEngineT<T> *engine, int width, int height, glm::mat3 &M_inv, int n_threads,
+                              EmulateProgress *progress = NULL);
+
+int EmulateThreadCount(int n_threads);
+
+#endif // EMULATE_H
@@ -0,0 +1,287 @@
+#include "image.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool ImageAlloc(Image *image, int width, int height, int channels)
+{
+    image->width = width;
+    image->height = height;
+    image->channels = channels;
+    image->data = (float*)calloc((size_t)width*height*channels,sizeof(float));
+    return image->data!=NULL;
+}
+
+void ImageFree(Image *image)
+{
+    free(image->data);
+    image->data = NULL;
+}
+
+//
+// read the next integer of a PNM header, skipping comments
+//
+static bool PNMReadInt(FILE *f, int *value)
+{
+    int c = fgetc(f);
+    while(c!=EOF){
+        if(c=='#'){
+            while(c!=EOF && c!='\n') c = fgetc(f);
+        }else if(c>='0' && c<='9'){
+            break;
+        }
+        c = fgetc(f);
+    }
+    if(c==EOF) return false;
+    *value = 0;
+    while(c>='0' && c<='9'){
+        *value = *value*10 + (c-'0');
+        c = fgetc(f);
+    }
+    // c is the single whitespace that terminates the value
+    return true;
+}
+
+//
+// the header of an 8 bit binary PGM (P5) or PPM (P6), f is left at the
+// first pixel
+//
+static bool PNMReadHeader(FILE *f, const char *filename, int *width, int *height,
+                          int *channels, int *maxval)
+{
+    char magic[2];
+    if(fread(magic,1,2,f)!=2 || magic[0]!='P' || (magic[1]!='5' && magic[1]!='6')
+            || !PNMReadInt(f,width) || !PNMReadInt(f,height) || !PNMReadInt(f,maxval)
+            || *width<=0 || *height<=0 || *maxval<=0 || *maxval>255){
+        fprintf(stderr,"%s is not an 8 bit binary PGM or PPM\n",filename);
+        return false;
+    }
+    *channels = (magic[1]=='5')?1:3;
+    return true;
+}
+
+//
+// 8 bit binary PGM (P5) and PPM (P6) only
+//
+bool ImageReadPNM(Image *image, const char *filename)
+{
+    FILE *f = fopen(filename,"rb");
+    if(!f){
+        fprintf(stderr,"unable to open %s\n",filename);
+        return false;
+    }
+    int width, height, channels, maxval;
+    if(!PNMReadHeader(f,filename,&width,&height,&channels,&maxval)){
+        fclose(f);
+        return false;
+    }
+    if(!ImageAlloc(image,width,height,channels)){
+        fclose(f);
+        return false;
+    }
+    size_t row_size = (size_t)width*channels;
+    unsigned char *row = (unsigned char*)malloc(row_size);
+    float *p = image->data;
+    float scale = 1.0f/maxval;
+    for(int y=0;y<height;y++){
+        if(fread(row,1,row_size,f)!=row_size){
+            fprintf(stderr,"%s is truncated\n",filename);
+            free(row);
+            ImageFree(image);
+            fclose(f);
+            return false;
+        }
+        for(size_t i=0;i<row_size;i++,p++){
+            *p = row[i]*scale;
+        }
+    }
+    free(row);
+    fclose(f);
+    return true;
+}
+
+//
+// n floats in [0,1] to bytes
+//
+static void PNMPackRow(const float *p, unsigned char *row, size_t n)
+{
+    for(size_t i=0;i<n;i++,p++){
+        float v = *p*255.0f + 0.5f;
+        if(v<0.0f) v = 0.0f;
+        if(v>255.0f) v = 255.0f;
+        row[i] = (unsigned char)v;
+    }
+}
+
+bool ImageWritePNM(Image *image, const char *filename)
+{
+    if(image->channels!=1 && image->channels!=3){
+        fprintf(stderr,"only 1 or 3 channel images can be written as PNM\n");
+        return false;
+    }
+    FILE *f = fopen(filename,"wb");
+    if(!f){
+        fprintf(stderr,"unable to open %s\n",filename);
+        return false;
+    }
+    fprintf(f,"P%c\n%d %d\n255\n",(image->channels==1)?'5':'6',image->width,image->height);
+    size_t row_size = (size_t)image->width*image->channels;
+    unsigned char *row = (unsigned char*)malloc(row_size);
+    float *p = image->data;
+    bool ok = true;
+    for(int y=0;y<image->height && ok;y++){
+        PNMPackRow(p,row,row_size);
+        p += row_size;
+        ok = fwrite(row,1,row_size,f)==row_size;
+    }
+    free(row);
+    if(fclose(f)!=0) ok = false;
+    if(!ok){
+        fprintf(stderr,"error writing %s\n",filename);
+    }
+    return ok;
+}
+
+bool ImageMapOpen(ImageMap *imageMap, const char *filename)
+{
+    memset(imageMap,0,sizeof(*imageMap));
+    FILE *f = fopen(filename,"rb");
+    if(!f){
+        fprintf(stderr,"unable to open %s\n",filename);
+        return false;
+    }
+    int maxval;
+    if(!PNMReadHeader(f,filename,&imageMap->width,&imageMap->height,
+                      &imageMap->channels,&maxval)){
+        fclose(f);
+        return false;
+    }
+    long data_offset = ftell(f);
+    struct stat st;
+    if(data_offset<0 || fstat(fileno(f),&st)!=0){
+        fprintf(stderr,"unable to read %s\n",filename);
+        fclose(f);
+        return false;
+    }
+    size_t data_size = (size_t)imageMap->width*imageMap->height*imageMap->channels;
+    if((size_t)st.st_size<(size_t)data_offset + data_size){
+        fprintf(stderr,"%s is truncated\n",filename);
+        fclose(f);
+        return false;
+    }
+    void *map = mmap(NULL,(size_t)st.st_size,PROT_READ,MAP_PRIVATE,fileno(f),0);
+    // the mapping keeps the file open
+    fclose(f);
+    if(map==MAP_FAILED){
+        fprintf(stderr,"unable to map %s\n",filename);
+        return false;
+    }
+    madvise(map,(size_t)st.st_size,MADV_SEQUENTIAL);
+    imageMap->scale = 1.0f/maxval;
+    imageMap->map = map;
+    imageMap->size = (size_t)st.st_size;
+    imageMap->pixels = (const unsigned char*)map + data_offset;
+    return true;
+}
+
+void ImageMapClose(ImageMap *imageMap)
+{
+    if(imageMap->map){
+        munmap(imageMap->map,imageMap->size);
+    }
+    memset(imageMap,0,sizeof(*imageMap));
+}
+
+void ImageMapReadRect(ImageMap *imageMap, int x0, int y0, Image *rect)
+{
+    size_t src_row_size = (size_t)imageMap->width*imageMap->channels;
+    size_t row_size = (size_t)rect->width*rect->channels;
+    float *p = rect->data;
+    for(int y=0;y<rect->height;y++){
+        const unsigned char *src = imageMap->pixels + (size_t)(y0+y)*src_row_size
+                + (size_t)x0*imageMap->channels;
+        for(size_t i=0;i<row_size;i++,p++){
+            *p = src[i]*imageMap->scale;
+        }
+    }
+}
+
+void ImageMapRelease(ImageMap *imageMap, int y_begin, int y_end)
+{
+    if(y_end<=y_begin) return;
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t src_row_size = (size_t)imageMap->width*imageMap->channels;
+    size_t begin = (size_t)(imageMap->pixels - (const unsigned char*)imageMap->map)
+            + (size_t)y_begin*src_row_size;
+    size_t end = begin + (size_t)(y_end-y_begin)*src_row_size;
+    // whole pages only, the ones at the ends may hold rows still needed
+    begin = (begin + page - 1)/page*page;
+    end = end/page*page;
+    if(end>begin){
+        madvise((char*)imageMap->map + begin,end - begin,MADV_DONTNEED);
+    }
+}
+
+bool ImageWriterOpen(ImageWriter *writer, const char *filename, int width, int height, int channels)
+{
+    memset(writer,0,sizeof(*writer));
+    writer->fd = -1;
+    if(channels!=1 && channels!=3){
+        fprintf(stderr,"only 1 or 3 channel images can be written as PNM\n");
+        return false;
+    }
+    int fd = open(filename,O_WRONLY|O_CREAT|O_TRUNC,0666);
+    if(fd<0){
+        fprintf(stderr,"unable to open %s\n",filename);
+        return false;
+    }
+    char header[64];
+    int n = snprintf(header,sizeof(header),"P%c\n%d %d\n255\n",(channels==1)?'5':'6',width,height);
+    size_t data_size = (size_t)width*height*channels;
+    if(write(fd,header,n)!=n || ftruncate(fd,(off_t)(n + data_size))!=0){
+        fprintf(stderr,"error writing %s\n",filename);
+        close(fd);
+        return false;
+    }
+    writer->fd = fd;
+    writer->width = width;
+    writer->height = height;
+    writer->channels = channels;
+    writer->data_offset = (size_t)n;
+    writer->row = (unsigned char*)malloc((size_t)width*channels);
+    return writer->row!=NULL;
+}
+
+bool ImageWriterWriteRect(ImageWriter *writer, Image *rect, int x0, int y0)
+{
+    size_t row_size = (size_t)rect->width*rect->channels;
+    size_t dst_row_size = (size_t)writer->width*writer->channels;
+    const float *p = rect->data;
+    for(int y=0;y<rect->height;y++,p+=row_size){
+        PNMPackRow(p,writer->row,row_size);
+        off_t offset = (off_t)(writer->data_offset + (size_t)(y0+y)*dst_row_size
+                               + (size_t)x0*writer->channels);
+        if(pwrite(writer->fd,writer->row,row_size,offset)!=(ssize_t)row_size){
+            fprintf(stderr,"error writing the output image\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ImageWriterClose(ImageWriter *writer)
+{
+    bool ok = true;
+    if(writer->fd>=0 && close(writer->fd)!=0){
+        fprintf(stderr,"error writing the output image\n");
+        ok = false;
+    }
+    free(writer->row);
+    writer->row = NULL;
+    writer->fd = -1;
+    return ok;
+}
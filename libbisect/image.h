@@ -0,0 +1,65 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stddef.h>
+
+//
+// A plain float image. Pixels are stored row by row with the channels
+// interleaved. Row 0 is the top of the image, which maps to y=0 in the
+// source coordinates, row r spans y=-r to y=-(r+1).
+//
+
+struct Image {
+    int width;
+    int height;
+    int channels;
+    float *data;
+};
+
+bool ImageAlloc(Image *image, int width, int height, int channels);
+void ImageFree(Image *image);
+
+bool ImageReadPNM(Image *image, const char *filename);
+bool ImageWritePNM(Image *image, const char *filename);
+
+//
+// An 8 bit PGM/PPM mapped read only. Only the rectangles that are read
+// are converted to float, the pages they came from can be handed back
+// with ImageMapRelease, so a source of any size can be read in pieces.
+//
+struct ImageMap {
+    int width;
+    int height;
+    int channels;
+    float scale;                  // 1/maxval
+    void *map;
+    size_t size;
+    const unsigned char *pixels;  // first row, inside the mapping
+};
+
+bool ImageMapOpen(ImageMap *imageMap, const char *filename);
+void ImageMapClose(ImageMap *imageMap);
+// the pixels of columns x0.. and rows y0.. into rect, which is allocated
+// with the size of the rectangle and the channels of the map
+void ImageMapReadRect(ImageMap *imageMap, int x0, int y0, Image *rect);
+// drops the pages of rows y_begin to y_end-1 from the process
+void ImageMapRelease(ImageMap *imageMap, int y_begin, int y_end);
+
+//
+// An 8 bit PGM/PPM written a rectangle at a time, in any order. The file
+// is created at its full size by ImageWriterOpen.
+//
+struct ImageWriter {
+    int fd;
+    int width;
+    int height;
+    int channels;
+    size_t data_offset;           // of the first row
+    unsigned char *row;
+};
+
+bool ImageWriterOpen(ImageWriter *writer, const char *filename, int width, int height, int channels);
+bool ImageWriterWriteRect(ImageWriter *writer, Image *rect, int x0, int y0);
+bool ImageWriterClose(ImageWriter *writer);
+
+#endif // IMAGE_H
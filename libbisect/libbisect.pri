@@ -0,0 +1,9 @@
+# Include from a project that links against libbisect.
+
+CONFIG += c++11 thread
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+LIBS += -L$$shadowed($$PWD) -lbisect
+PRE_TARGETDEPS += $$shadowed($$PWD)/libbisect.a
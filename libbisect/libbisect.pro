@@ -0,0 +1,39 @@
+#-------------------------------------------------
+#
+# GUI-free bisection engine. Static library shared by the
+# viewer and the headless tools.
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = bisect
+TEMPLATE = lib
+CONFIG += staticlib c++11 thread
+
+# hot path counters of the engine, see counters.h
+bisect_counters: DEFINES += BISECT_COUNTERS
+
+SOURCES += \
+        arena.cpp \
+        bisect.cpp \
+        bisect_simd.cpp \
+        bisectengine.cpp \
+        corpus.cpp \
+        counters.cpp \
+        emulate.cpp \
+        image.cpp \
+        phasetable.cpp \
+        resample.cpp
+
+HEADERS += \
+        arena.h \
+        bisect.h \
+        bisectengine.h \
+        corpus.h \
+        counters.h \
+        emulate.h \
+        image.h \
+        phasetable.h \
+        resample.h \
+        scalar.h
@@ -0,0 +1,145 @@
+#include "phasetable.h"
+#include <math.h>
+#include <stdio.h>
+
+//
+// exact coverage of the footprint placed at v2_src00 inside the pixel
+// with its corner at the origin
+//
+static void PhaseCoverage(BisectEngine *engine, PhaseTable *pt, glm::vec2 v2_src00)
+{
+    SrcPolygonInitParallelogram(&engine->srcPolygon,v2_src00,pt->v2_dsrcx,pt->v2_dsrcy);
+    SrcPolygonInitEdges(&engine->srcPolygon);
+    engine->InitPixels();
+    engine->BisectAndCoverPixels();
+}
+
+//
+// the phase of v2_src00 and the pixel offset of the table entries
+//
+static int PhaseIndex(PhaseTable *pt, glm::vec2 v2_src00, glm::ivec2 *i2_base)
+{
+    glm::vec2 v2_floor = glm::floor(v2_src00);
+    glm::vec2 v2_phase = v2_src00 - v2_floor;
+    int ix = (int)(v2_phase.x*pt->phases);
+    int iy = (int)(v2_phase.y*pt->phases);
+    if(ix>=pt->phases) ix = pt->phases-1;
+    if(iy>=pt->phases) iy = pt->phases-1;
+    // moving the footprint up by one moves the pixel rows down by one
+    *i2_base = glm::ivec2((int)v2_floor.x,-(int)v2_floor.y);
+    return iy*pt->phases + ix;
+}
+
+bool PhaseTableInit(PhaseTable *pt, glm::mat3 &M_inv, int phases)
+{
+    if(phases<1){
+        fprintf(stderr,"phase table: at least one phase is needed\n");
+        return false;
+    }
+    if(!ResampleInitSteps(M_inv,&pt->v2_dsrcx,&pt->v2_dsrcy)){
+        return false;
+    }
+    pt->phases = phases;
+    pt->src_area = fabsf(f2cross(pt->v2_dsrcy,pt->v2_dsrcx));
+    pt->first.resize(phases*phases+1);
+    pt->covered_areas.resize(phases*phases);
+    pt->weights.clear();
+
+    BisectEngine *engine = new BisectEngine;
+    float cell = 1.0f/phases;
+    for(int iy=0;iy<phases;iy++){
+        for(int ix=0;ix<phases;ix++){
+            pt->first[iy*phases+ix] = (int)pt->weights.size();
+            PhaseCoverage(engine,pt,glm::vec2((ix+0.5f)*cell,(iy+0.5f)*cell));
+            pt->weights.insert(pt->weights.end(),engine->coverage.begin(),engine->coverage.end());
+            pt->covered_areas[iy*phases+ix] = ResampleCoveredArea(engine->coverage.data(),
+                                                                  (int)engine->coverage.size(),NULL,0);
+        }
+    }
+    pt->first[phases*phases] = (int)pt->weights.size();
+
+    //
+    // Moving the footprint by d changes the coverage of the pixels by at
+    // most the area swept between the two footprints, so the sum of the
+    // absolute changes is at most perimeter*|d|. A lookup is off by at most
+    // half the diagonal of a phase cell, which bounds the relative error of
+    // exact coverage. The clipping of the table and of the footprint it
+    // stands for have errors of their own. area_error_max measures both,
+    // and should not come out above the bound.
+    //
+    float perimeter = 2.0f*(glm::length(pt->v2_dsrcx) + glm::length(pt->v2_dsrcy));
+    pt->area_error_bound = perimeter*(0.5f*sqrtf(2.0f)*cell)/pt->src_area;
+
+    //
+    // measure the error at the corners of every phase cell, the points
+    // farthest from where the entry was taken. The differences are
+    // gathered on a grid of pixel offsets around the origin.
+    //
+    glm::vec2 v2_extent = glm::abs(pt->v2_dsrcx) + glm::abs(pt->v2_dsrcy);
+    int reach = (int)ceilf(glm::max(v2_extent.x,v2_extent.y)) + 2;
+    int span = 2*reach+1;
+    std::vector<float> diff(span*span,0.0f);
+    pt->area_error_max = 0.0f;
+    for(int iy=0;iy<phases;iy++){
+        for(int ix=0;ix<phases;ix++){
+            for(int corner=0;corner<4;corner++){
+                glm::vec2 v2_src00((ix + (corner&1))*cell,(iy + (corner>>1))*cell);
+                // stay inside the cell
+                v2_src00 = glm::min(v2_src00,glm::vec2((ix+1)*cell - 1e-6f,(iy+1)*cell - 1e-6f));
+                glm::ivec2 i2_base;
+                int k = PhaseIndex(pt,v2_src00,&i2_base);
+                PhaseCoverage(engine,pt,v2_src00);
+                for(int i=pt->first[k];i<pt->first[k+1];i++){
+                    glm::ivec2 i2 = pt->weights[i].i2_pixel + reach;
+                    diff[i2.y*span + i2.x] += pt->weights[i].area;
+                }
+                for(size_t i=0;i<engine->coverage.size();i++){
+                    glm::ivec2 i2 = engine->coverage[i].i2_pixel + reach;
+                    diff[i2.y*span + i2.x] -= engine->coverage[i].area;
+                }
+                float error = 0.0f;
+                for(int i=pt->first[k];i<pt->first[k+1];i++){
+                    glm::ivec2 i2 = pt->weights[i].i2_pixel + reach;
+                    error += fabsf(diff[i2.y*span + i2.x]);
+                    diff[i2.y*span + i2.x] = 0.0f;
+                }
+                for(size_t i=0;i<engine->coverage.size();i++){
+                    glm::ivec2 i2 = engine->coverage[i].i2_pixel + reach;
+                    error += fabsf(diff[i2.y*span + i2.x]);
+                    diff[i2.y*span + i2.x] = 0.0f;
+                }
+                error /= pt->src_area;
+                if(error>pt->area_error_max) pt->area_error_max = error;
+            }
+        }
+    }
+    delete engine;
+    return true;
+}
+
+bool resamplePhase(Image *srcImage, Image *dstImage, glm::mat3 &M_inv, PhaseTable *pt)
+{
+    if(srcImage->channels!=dstImage->channels){
+        fprintf(stderr,"resample: channel count mismatch\n");
+        return false;
+    }
+    int channels = dstImage->channels;
+    float *dst = dstImage->data;
+    for(int y=0;y<dstImage->height;y++){
+        glm::vec3 v3_y(0.0f,-(float)y,1.0f);
+        glm::vec2 v2_src00(M_inv*v3_y);
+        for(int x=0;x<dstImage->width;x++,v2_src00+=pt->v2_dsrcx,dst+=channels){
+            glm::ivec2 i2_base;
+            int k = PhaseIndex(pt,v2_src00,&i2_base);
+            if(!(pt->covered_areas[k]>0.0f)){
+                for(int c=0;c<channels;c++){
+                    dst[c] = 0.0f;
+                }
+                continue;
+            }
+            ResampleAccumulate(srcImage,&pt->weights[pt->first[k]],pt->first[k+1]-pt->first[k],
+                               i2_base,pt->covered_areas[k],dst);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,28 @@
+#ifndef PHASETABLE_H
+#define PHASETABLE_H
+
+#include "resample.h"
+
+//
+// Under an affine transform every destination pixel has the same
+// footprint, only its position within the source pixel grid changes. The
+// phase table holds the exact coverage of the footprint for a grid of
+// phases x phases sub-pixel positions, taken at the center of each phase
+// cell. Resampling then looks up the nearest phase instead of clipping.
+//
+struct PhaseTable {
+    int phases;                          // phases along each axis
+    glm::vec2 v2_dsrcx;
+    glm::vec2 v2_dsrcy;
+    float src_area;
+    std::vector<int> first;              // first weight of each phase, phases*phases+1 entries
+    std::vector<PixelCoverage> weights;  // pixels relative to the one holding v2_src00
+    std::vector<float> covered_areas;    // the area the weights of each phase add up to
+    float area_error_bound;              // bound on the relative area error of a lookup, exact coverage
+    float area_error_max;                // worst relative error measured at the cell corners
+};
+
+bool PhaseTableInit(PhaseTable *pt, glm::mat3 &M_inv, int phases);
+bool resamplePhase(Image *srcImage, Image *dstImage, glm::mat3 &M_inv, PhaseTable *pt);
+
+#endif // PHASETABLE_H
@@ -0,0 +1,654 @@
+#include "resample.h"
+#include "bisectengine.h"
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+bool ResampleInitSteps(glm::mat3 &M_inv, glm::vec2 *v2_dsrcx, glm::vec2 *v2_dsrcy)
+{
+    glm::vec3 v3_dx(1.0f,0.0f,0.0f);
+    glm::vec3 v3_dy(0.0f,-1.0f,0.0f);
+    *v2_dsrcx = v2conform_axis(glm::vec2(M_inv*v3_dx));
+    *v2_dsrcy = v2conform_axis(glm::vec2(M_inv*v3_dy));
+
+    if(TransformProjective(M_inv)){
+        fprintf(stderr,"resample: a projective transform has no steps, use resample\n");
+        return false;
+    }
+    float src_area = fabsf(f2cross(*v2_dsrcy,*v2_dsrcx));
+    if(!(src_area>0.0f)){
+        fprintf(stderr,"resample: degenerate transform\n");
+        return false;
+    }
+    return true;
+}
+
+float ResampleCoveredArea(const PixelCoverage *coverage, int n, const CoverageSpan *spans, int n_spans)
+{
+    float area = 0.0f;
+    for(int i=0;i<n;i++){
+        area += coverage[i].area;
+    }
+    for(int i=0;i<n_spans;i++){
+        area += (float)spans[i].n;
+    }
+    return area;
+}
+
+void ResampleAccumulate(Image *srcImage, PixelCoverage *coverage, int n,
+                        glm::ivec2 i2_base, float covered_area, float *dst)
+{
+    int channels = srcImage->channels;
+    for(int c=0;c<channels;c++){
+        dst[c] = 0.0f;
+    }
+    for(int i=0;i<n;i++){
+        glm::ivec2 i2_pixel = coverage[i].i2_pixel + i2_base;
+        if(i2_pixel.x<0 || i2_pixel.x>=srcImage->width
+                || i2_pixel.y<0 || i2_pixel.y>=srcImage->height){
+            continue;
+        }
+        float *src = srcImage->data +
+                ((size_t)i2_pixel.y*srcImage->width + i2_pixel.x)*channels;
+        for(int c=0;c<channels;c++){
+            dst[c] += coverage[i].area*src[c];
+        }
+    }
+    float inv_area = 1.0f/covered_area;
+    for(int c=0;c<channels;c++){
+        dst[c] *= inv_area;
+    }
+}
+
+void RowSumTableInit(RowSumTable *table, Image *image)
+{
+    int channels = image->channels;
+    table->width = image->width;
+    table->height = image->height;
+    table->channels = channels;
+    table->sums.resize((size_t)(image->width+1)*image->height*channels);
+    double *sum = table->sums.data();
+    const float *src = image->data;
+    for(int y=0;y<image->height;y++){
+        for(int c=0;c<channels;c++){
+            sum[c] = 0.0;
+        }
+        for(int x=0;x<image->width;x++,src+=channels,sum+=channels){
+            for(int c=0;c<channels;c++){
+                sum[channels+c] = sum[c] + src[c];
+            }
+        }
+        sum += channels;
+    }
+}
+
+void ResampleAccumulateSpans(RowSumTable *table, CoverageSpan *spans, int n,
+                             glm::ivec2 i2_base, float covered_area, float *dst)
+{
+    int channels = table->channels;
+    size_t row_size = (size_t)(table->width+1)*channels;
+    float inv_area = 1.0f/covered_area;
+    // a channel at a time, so that any number of channels is summed in double
+    for(int c=0;c<channels;c++){
+        double acc = 0.0;
+        for(int i=0;i<n;i++){
+            int row = spans[i].i2_pixel.y + i2_base.y;
+            if(row<0 || row>=table->height) continue;
+            int x = spans[i].i2_pixel.x + i2_base.x;
+            int x0 = glm::max(x,0);
+            int x1 = glm::min(x + spans[i].n,table->width);
+            if(x1<=x0) continue;
+            const double *sum = table->sums.data() + (size_t)row*row_size;
+            acc += sum[(size_t)x1*channels+c] - sum[(size_t)x0*channels+c];
+        }
+        dst[c] += (float)acc*inv_area;
+    }
+}
+
+//
+// The 1D overlaps of n intervals [t0 + (i0+i)*dt, t0 + (i0+i+1)*dt] with
+// the unit pixels [p,p+1] of the size pixels of a source axis from p_base
+// on, divided by |dt|. The weights of interval i are
+// weights[first[i]..first[i+1]), starting at pixel p_base + pixel0[i].
+// Pixels off the axis are left out.
+//
+struct AxisWeights {
+    std::vector<int> first;
+    std::vector<int> pixel0;
+    std::vector<float> weights;
+};
+
+static void AxisWeightsInit(AxisWeights *aw, float t0, float dt, int i0, int n, int p_base, int size)
+{
+    aw->first.resize(n+1);
+    aw->pixel0.resize(n);
+    aw->weights.clear();
+    float inv_dt = 1.0f/fabsf(dt);
+    for(int i=0;i<n;i++){
+        float ta = t0 + (float)(i0+i)*dt;
+        float tb = ta + dt;
+        float lo = glm::min(ta,tb);
+        float hi = glm::max(ta,tb);
+        int p0 = glm::max((int)floorf(lo),p_base);
+        int p1 = glm::min((int)ceilf(hi),p_base+size);
+        aw->first[i] = (int)aw->weights.size();
+        aw->pixel0[i] = p0 - p_base;
+        for(int p=p0;p<p1;p++){
+            float w = glm::min(hi,(float)(p+1)) - glm::max(lo,(float)p);
+            aw->weights.push_back(w*inv_dt);
+        }
+    }
+    aw->first[n] = (int)aw->weights.size();
+}
+
+//
+// Resampling for a transform that maps the destination pixels onto axis
+// aligned rectangles, a scale with or without a flip. The area of a
+// rectangle in a source pixel is the product of its overlaps in x and y,
+// so the weights are set up once per destination column and once per
+// destination row and applied in two passes, first along the source rows
+// and then down the destination columns.
+//
+// srcImage holds the source from column i2_src0.x and row i2_src0.y on,
+// dstImage the destination from i2_dst0 on. The rectangles are laid out
+// from M_inv and the destination pixel as for the whole image, so a tile
+// comes out the same as that part of the whole image.
+//
+static bool ResampleSeparableRect(Image *srcImage, glm::ivec2 i2_src0, Image *dstImage,
+                                  glm::ivec2 i2_dst0, glm::mat3 &M_inv)
+{
+    if(srcImage->channels!=dstImage->channels){
+        fprintf(stderr,"resample: channel count mismatch\n");
+        return false;
+    }
+    glm::vec2 v2_dsrcx;
+    glm::vec2 v2_dsrcy;
+    if(!ResampleInitSteps(M_inv,&v2_dsrcx,&v2_dsrcy)){
+        return false;
+    }
+    if(v2_dsrcx.y!=0.0f || v2_dsrcy.x!=0.0f){
+        fprintf(stderr,"resample: transform is not a scale\n");
+        return false;
+    }
+    //
+    // the rectangles are laid out from the conformed steps, source rows
+    // run down the negative y axis
+    //
+    glm::vec3 v3_origin(0.0f,0.0f,1.0f);
+    glm::vec2 v2_origin(M_inv*v3_origin);
+    AxisWeights xWeights;
+    AxisWeights yWeights;
+    AxisWeightsInit(&xWeights,v2_origin.x,v2_dsrcx.x,i2_dst0.x,dstImage->width,
+                    i2_src0.x,srcImage->width);
+    AxisWeightsInit(&yWeights,-v2_origin.y,-v2_dsrcy.y,i2_dst0.y,dstImage->height,
+                    i2_src0.y,srcImage->height);
+
+    //
+    // the source rows any destination row touches
+    //
+    int row_begin = srcImage->height;
+    int row_end = 0;
+    for(int y=0;y<dstImage->height;y++){
+        int n = yWeights.first[y+1] - yWeights.first[y];
+        if(n==0) continue;
+        row_begin = glm::min(row_begin,yWeights.pixel0[y]);
+        row_end = glm::max(row_end,yWeights.pixel0[y]+n);
+    }
+
+    //
+    // horizontal pass into one row of destination width per source row
+    //
+    int channels = dstImage->channels;
+    size_t row_size = (size_t)dstImage->width*channels;
+    std::vector<float> rows((size_t)glm::max(row_end-row_begin,0)*row_size);
+    for(int r=row_begin;r<row_end;r++){
+        float *src_row = srcImage->data + (size_t)r*srcImage->width*channels;
+        float *dst = rows.data() + (size_t)(r-row_begin)*row_size;
+        for(int x=0;x<dstImage->width;x++,dst+=channels){
+            for(int c=0;c<channels;c++){
+                dst[c] = 0.0f;
+            }
+            float *src = src_row + (size_t)xWeights.pixel0[x]*channels;
+            for(int i=xWeights.first[x];i<xWeights.first[x+1];i++,src+=channels){
+                float w = xWeights.weights[i];
+                for(int c=0;c<channels;c++){
+                    dst[c] += w*src[c];
+                }
+            }
+        }
+    }
+
+    //
+    // vertical pass
+    //
+    for(int y=0;y<dstImage->height;y++){
+        float *dst = dstImage->data + (size_t)y*row_size;
+        for(size_t k=0;k<row_size;k++){
+            dst[k] = 0.0f;
+        }
+        if(yWeights.first[y]==yWeights.first[y+1]) continue;
+        float *row = rows.data() + (size_t)(yWeights.pixel0[y]-row_begin)*row_size;
+        for(int i=yWeights.first[y];i<yWeights.first[y+1];i++,row+=row_size){
+            float w = yWeights.weights[i];
+            for(size_t k=0;k<row_size;k++){
+                dst[k] += w*row[k];
+            }
+        }
+    }
+    return true;
+}
+
+bool ResampleSeparable(Image *srcImage, Image *dstImage, glm::mat3 &M_inv)
+{
+    return ResampleSeparableRect(srcImage,glm::ivec2(0),dstImage,glm::ivec2(0),M_inv);
+}
+
+//
+// dst from the coverage the engine left for a footprint, and from the
+// covered spans summed in table when there is one. srcImage and table
+// start at source pixel i2_src0. A footprint with no coverage is black.
+//
+static void ResampleAccumulateFootprint(BisectEngine *engine, Image *srcImage, glm::ivec2 i2_src0,
+                                        RowSumTable *table, float *dst)
+{
+    int n = (int)engine->coverage.size();
+    int n_spans = table ? (int)engine->coveredSpans.size() : 0;
+    float covered_area = ResampleCoveredArea(engine->coverage.data(),n,
+                                             engine->coveredSpans.data(),n_spans);
+    if(!(covered_area>0.0f)){
+        for(int c=0;c<srcImage->channels;c++){
+            dst[c] = 0.0f;
+        }
+        return;
+    }
+    ResampleAccumulate(srcImage,engine->coverage.data(),n,-i2_src0,covered_area,dst);
+    if(table){
+        ResampleAccumulateSpans(table,engine->coveredSpans.data(),n_spans,-i2_src0,covered_area,dst);
+    }
+}
+
+//
+// The perspective path of ResamplePolygons. Every destination pixel maps
+// to a quad of its own, see BisectEngine::InitQuad. Pixels reaching the
+// horizon are left black.
+//
+static bool ResampleProjective(Image *srcImage, glm::ivec2 i2_src0, Image *dstImage,
+                               glm::ivec2 i2_dst0, glm::mat3 &M_inv, RowSumTable *table)
+{
+    BisectEngine *engine = new BisectEngine;
+    engine->cover_spans = table!=NULL;
+    int channels = dstImage->channels;
+    float *dst = dstImage->data;
+    for(int y=0;y<dstImage->height;y++){
+        for(int x=0;x<dstImage->width;x++,dst+=channels){
+            float src_area = 0.0f;
+            if(engine->InitQuad(M_inv,i2_dst0.x+x,i2_dst0.y+y)){
+                src_area = SrcPolygonArea(&engine->srcPolygon);
+            }
+            if(!(src_area>0.0f)){
+                for(int c=0;c<channels;c++){
+                    dst[c] = 0.0f;
+                }
+                continue;
+            }
+            engine->InitPixels();
+            engine->BisectAndCoverPixels();
+            ResampleAccumulateFootprint(engine,srcImage,i2_src0,table,dst);
+        }
+    }
+    delete engine;
+    return true;
+}
+
+//
+// the polygon path of resample and resampleSummed, with the covered runs
+// of the footprint rows summed from table when there is one. srcImage and
+// table hold the source from pixel i2_src0 on, dstImage the destination
+// from pixel i2_dst0 on. Every footprint is placed from M_inv and its
+// destination pixel in the whole image, so resampling in tiles gives the
+// same pixels as resampling at once.
+//
+static bool ResamplePolygons(Image *srcImage, glm::ivec2 i2_src0, Image *dstImage,
+                             glm::ivec2 i2_dst0, glm::mat3 &M_inv, RowSumTable *table)
+{
+    if(srcImage->channels!=dstImage->channels){
+        fprintf(stderr,"resample: channel count mismatch\n");
+        return false;
+    }
+    if(TransformProjective(M_inv)){
+        return ResampleProjective(srcImage,i2_src0,dstImage,i2_dst0,M_inv,table);
+    }
+    glm::vec2 v2_dsrcx;
+    glm::vec2 v2_dsrcy;
+    if(!ResampleInitSteps(M_inv,&v2_dsrcx,&v2_dsrcy)){
+        return false;
+    }
+    if(v2_dsrcx.y==0.0f && v2_dsrcy.x==0.0f){
+        return ResampleSeparableRect(srcImage,i2_src0,dstImage,i2_dst0,M_inv);
+    }
+    BisectEngine *engine = new BisectEngine;
+    engine->cover_spans = table!=NULL;
+    int channels = dstImage->channels;
+    float *dst = dstImage->data;
+    for(int y=i2_dst0.y;y<i2_dst0.y+dstImage->height;y++){
+        for(int x=i2_dst0.x;x<i2_dst0.x+dstImage->width;x++,dst+=channels){
+            glm::vec3 v3_dst((float)x,-(float)y,1.0f);
+            glm::vec2 v2_src00(M_inv*v3_dst);
+            SrcPolygonInitParallelogram(&engine->srcPolygon,v2_src00,v2_dsrcx,v2_dsrcy);
+            SrcPolygonInitEdges(&engine->srcPolygon);
+            engine->InitPixels();
+            engine->BisectAndCoverPixels();
+            ResampleAccumulateFootprint(engine,srcImage,i2_src0,table,dst);
+        }
+    }
+    delete engine;
+    return true;
+}
+
+bool resample(Image *srcImage, Image *dstImage, glm::mat3 &M_inv)
+{
+    return ResamplePolygons(srcImage,glm::ivec2(0),dstImage,glm::ivec2(0),M_inv,NULL);
+}
+
+bool resampleSummed(Image *srcImage, RowSumTable *table, Image *dstImage, glm::mat3 &M_inv)
+{
+    return ResamplePolygons(srcImage,glm::ivec2(0),dstImage,glm::ivec2(0),M_inv,table);
+}
+
+// the largest tile tried by ResampleStream
+#define STREAM_TILE_SIZE 256
+
+//
+// The source rectangle [x0,x1) x [y0,y1) in columns and rows that the
+// destination tile of w by h pixels at (tx,ty) reads, clamped to the
+// source. resample lays the footprints out from the conformed steps, which
+// differ from the transform by up to v2conform_axis's tolerance, so the
+// box of the tile corners is grown by that and by a pixel for rounding.
+//
+static void StreamSourceRect(glm::mat3 &M_inv, glm::vec2 v2_dsrcx, glm::vec2 v2_dsrcy,
+                             int tx, int ty, int w, int h, int src_width, int src_height,
+                             glm::ivec2 *i2_min, glm::ivec2 *i2_max)
+{
+    glm::vec2 v2_lo(INFINITY,INFINITY);
+    glm::vec2 v2_hi(-INFINITY,-INFINITY);
+    for(int i=0;i<4;i++){
+        glm::vec3 v3_dst((float)(tx + (i&1)*w),-(float)(ty + (i>>1)*h),1.0f);
+        glm::vec2 v2_src(M_inv*v3_dst);
+        v2_lo = glm::min(v2_lo,v2_src);
+        v2_hi = glm::max(v2_hi,v2_src);
+    }
+    glm::vec2 v2_dx(M_inv*glm::vec3(1.0f,0.0f,0.0f));
+    glm::vec2 v2_dy(M_inv*glm::vec3(0.0f,-1.0f,0.0f));
+    glm::vec2 v2_slack = (float)w*glm::abs(v2_dx - v2_dsrcx) + (float)h*glm::abs(v2_dy - v2_dsrcy)
+            + glm::vec2(1.0f);
+    v2_lo -= v2_slack;
+    v2_hi += v2_slack;
+    // rows run down the negative y axis
+    i2_min->x = glm::max((int)floorf(v2_lo.x),0);
+    i2_max->x = glm::min((int)ceilf(v2_hi.x),src_width);
+    i2_min->y = glm::max((int)floorf(-v2_hi.y),0);
+    i2_max->y = glm::min((int)ceilf(-v2_lo.y),src_height);
+}
+
+bool ResampleStream(ImageMap *srcMap, const char *output, int width, int height,
+                    glm::mat3 &M_inv, size_t max_bytes, bool summed)
+{
+    glm::vec2 v2_dsrcx;
+    glm::vec2 v2_dsrcy;
+    if(!ResampleInitSteps(M_inv,&v2_dsrcx,&v2_dsrcy)){
+        return false;
+    }
+    int channels = srcMap->channels;
+
+    //
+    // halve the tile until the source under it fits, the bound holds for
+    // every tile since an affine transform maps them all to the same shape
+    //
+    size_t pixel_bytes = (size_t)channels*sizeof(float);
+    glm::vec2 v2_extent = glm::abs(v2_dsrcx) + glm::abs(v2_dsrcy);
+    int tile = STREAM_TILE_SIZE;
+    for(;;){
+        glm::vec2 v2_src = (float)tile*v2_extent*(1.0f + 2e-3f) + glm::vec2(3.0f);
+        double src_bytes = (double)ceilf(v2_src.x + 1.0f)*ceilf(v2_src.y + 1.0f)*pixel_bytes;
+        // the row sums are doubles, one more per row
+        if(summed) src_bytes += (double)ceilf(v2_src.x + 2.0f)*ceilf(v2_src.y + 1.0f)*2*pixel_bytes;
+        // the separable pass keeps a destination row per source row
+        double rows_bytes = (double)ceilf(v2_src.y + 1.0f)*tile*pixel_bytes;
+        double dst_bytes = (double)tile*tile*pixel_bytes;
+        if(src_bytes + rows_bytes + dst_bytes<=(double)max_bytes) break;
+        if(tile==1){
+            fprintf(stderr,"resample: the footprint of one pixel does not fit in %zu bytes\n",max_bytes);
+            return false;
+        }
+        tile /= 2;
+    }
+
+    ImageWriter writer;
+    if(!ImageWriterOpen(&writer,output,width,height,channels)){
+        ImageWriterClose(&writer);
+        return false;
+    }
+    bool ok = true;
+    for(int ty=0;ty<height && ok;ty+=tile){
+        int h = glm::min(tile,height-ty);
+        int band_begin = srcMap->height;
+        int band_end = 0;
+        for(int tx=0;tx<width && ok;tx+=tile){
+            int w = glm::min(tile,width-tx);
+            glm::ivec2 i2_min;
+            glm::ivec2 i2_max;
+            StreamSourceRect(M_inv,v2_dsrcx,v2_dsrcy,tx,ty,w,h,srcMap->width,srcMap->height,
+                             &i2_min,&i2_max);
+            Image dstTile;
+            if(!ImageAlloc(&dstTile,w,h,channels)){
+                fprintf(stderr,"resample: unable to allocate a tile\n");
+                ok = false;
+                break;
+            }
+            if(i2_max.x>i2_min.x && i2_max.y>i2_min.y){
+                Image srcRect;
+                if(!ImageAlloc(&srcRect,i2_max.x-i2_min.x,i2_max.y-i2_min.y,channels)){
+                    fprintf(stderr,"resample: unable to allocate a source rectangle\n");
+                    ImageFree(&dstTile);
+                    ok = false;
+                    break;
+                }
+                ImageMapReadRect(srcMap,i2_min.x,i2_min.y,&srcRect);
+                band_begin = glm::min(band_begin,i2_min.y);
+                band_end = glm::max(band_end,i2_max.y);
+                //
+                // the footprints are placed by M_inv as for the whole
+                // image, only the source pixels are read from the rectangle
+                //
+                glm::ivec2 i2_dst0(tx,ty);
+                if(summed){
+                    RowSumTable table;
+                    RowSumTableInit(&table,&srcRect);
+                    ok = ResamplePolygons(&srcRect,i2_min,&dstTile,i2_dst0,M_inv,&table);
+                }else{
+                    ok = ResamplePolygons(&srcRect,i2_min,&dstTile,i2_dst0,M_inv,NULL);
+                }
+                ImageFree(&srcRect);
+            }
+            // tiles that miss the source stay zero
+            if(ok){
+                ok = ImageWriterWriteRect(&writer,&dstTile,tx,ty);
+            }
+            ImageFree(&dstTile);
+        }
+        ImageMapRelease(srcMap,band_begin,band_end);
+    }
+    if(!ImageWriterClose(&writer)) ok = false;
+    return ok;
+}
+
+//
+// appends an entry to the plan, false if it has outgrown its 32 bit
+// indices
+//
+static bool ResamplePlanAdd(ResamplePlan *plan, size_t offset, float weight)
+{
+    if(offset>UINT32_MAX || plan->index.size()>=UINT32_MAX){
+        fprintf(stderr,"resample plan: more than 2^32 entries or source floats\n");
+        return false;
+    }
+    plan->index.push_back((uint32_t)offset);
+    plan->weights.push_back(weight);
+    return true;
+}
+
+//
+// the weights of ResampleSeparable, the product of the overlaps in x and y
+//
+static bool ResamplePlanSeparable(ResamplePlan *plan, glm::mat3 &M_inv,
+                                  glm::vec2 v2_dsrcx, glm::vec2 v2_dsrcy)
+{
+    glm::vec3 v3_origin(0.0f,0.0f,1.0f);
+    glm::vec2 v2_origin(M_inv*v3_origin);
+    AxisWeights xWeights;
+    AxisWeights yWeights;
+    AxisWeightsInit(&xWeights,v2_origin.x,v2_dsrcx.x,0,plan->dst_width,0,plan->src_width);
+    AxisWeightsInit(&yWeights,-v2_origin.y,-v2_dsrcy.y,0,plan->dst_height,0,plan->src_height);
+    int channels = plan->channels;
+    size_t i = 0;
+    for(int y=0;y<plan->dst_height;y++){
+        for(int x=0;x<plan->dst_width;x++,i++){
+            plan->first[i] = (uint32_t)plan->index.size();
+            for(int j=yWeights.first[y];j<yWeights.first[y+1];j++){
+                int row = yWeights.pixel0[y] + j - yWeights.first[y];
+                size_t offset = ((size_t)row*plan->src_width + xWeights.pixel0[x])*channels;
+                for(int k=xWeights.first[x];k<xWeights.first[x+1];k++,offset+=channels){
+                    if(!ResamplePlanAdd(plan,offset,yWeights.weights[j]*xWeights.weights[k])){
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    plan->first[i] = (uint32_t)plan->index.size();
+    return true;
+}
+
+bool ResamplePlanInit(ResamplePlan *plan, int src_width, int src_height, int dst_width,
+                      int dst_height, int channels, glm::mat3 &M_inv)
+{
+    plan->src_width = src_width;
+    plan->src_height = src_height;
+    plan->dst_width = dst_width;
+    plan->dst_height = dst_height;
+    plan->channels = channels;
+    plan->first.resize((size_t)dst_width*dst_height+1);
+    plan->index.clear();
+    plan->weights.clear();
+    glm::vec2 v2_dsrcx(0.0f);
+    glm::vec2 v2_dsrcy(0.0f);
+    bool projective = TransformProjective(M_inv);
+    if(!projective){
+        if(!ResampleInitSteps(M_inv,&v2_dsrcx,&v2_dsrcy)){
+            return false;
+        }
+        if(v2_dsrcx.y==0.0f && v2_dsrcy.x==0.0f){
+            return ResamplePlanSeparable(plan,M_inv,v2_dsrcx,v2_dsrcy);
+        }
+    }
+
+    BisectEngine *engine = new BisectEngine;
+    bool ok = true;
+    size_t i = 0;
+    for(int y=0;y<dst_height && ok;y++){
+        for(int x=0;x<dst_width && ok;x++,i++){
+            plan->first[i] = (uint32_t)plan->index.size();
+            if(projective){
+                // each quad has an area of its own, pixels reaching the
+                // horizon get no weights
+                float src_area = engine->InitQuad(M_inv,x,y) ? SrcPolygonArea(&engine->srcPolygon) : 0.0f;
+                if(!(src_area>0.0f)) continue;
+            }else{
+                // placed as in resample
+                glm::vec3 v3_dst((float)x,-(float)y,1.0f);
+                glm::vec2 v2_src00(M_inv*v3_dst);
+                SrcPolygonInitParallelogram(&engine->srcPolygon,v2_src00,v2_dsrcx,v2_dsrcy);
+                SrcPolygonInitEdges(&engine->srcPolygon);
+            }
+            engine->InitPixels();
+            engine->BisectAndCoverPixels();
+            // as in resample the weights add up to 1 over the coverage found
+            float covered_area = ResampleCoveredArea(engine->coverage.data(),
+                                                     (int)engine->coverage.size(),NULL,0);
+            if(!(covered_area>0.0f)) continue;
+            float inv_area = 1.0f/covered_area;
+            for(size_t k=0;k<engine->coverage.size() && ok;k++){
+                glm::ivec2 i2_pixel = engine->coverage[k].i2_pixel;
+                if(i2_pixel.x<0 || i2_pixel.x>=src_width
+                        || i2_pixel.y<0 || i2_pixel.y>=src_height){
+                    continue;
+                }
+                size_t offset = ((size_t)i2_pixel.y*src_width + i2_pixel.x)*channels;
+                ok = ResamplePlanAdd(plan,offset,engine->coverage[k].area*inv_area);
+            }
+        }
+    }
+    delete engine;
+    if(ok){
+        plan->first[i] = (uint32_t)plan->index.size();
+    }
+    return ok;
+}
+
+//
+// the gather of ResamplePlanApply with the channels known at compile time,
+// so the accumulators stay in registers and the loop over the entries of
+// a pixel is a multiply-add per channel
+//
+template<int C>
+static void ResamplePlanGather(ResamplePlan *plan, const float *src, float *dst)
+{
+    const uint32_t *first = plan->first.data();
+    const uint32_t *index = plan->index.data();
+    const float *weights = plan->weights.data();
+    size_t n = (size_t)plan->dst_width*plan->dst_height;
+    for(size_t i=0;i<n;i++,dst+=C){
+        float acc[C];
+        for(int c=0;c<C;c++){
+            acc[c] = 0.0f;
+        }
+        for(uint32_t k=first[i];k<first[i+1];k++){
+            const float *s = src + index[k];
+            float w = weights[k];
+            for(int c=0;c<C;c++){
+                acc[c] += w*s[c];
+            }
+        }
+        for(int c=0;c<C;c++){
+            dst[c] = acc[c];
+        }
+    }
+}
+
+bool ResamplePlanApply(ResamplePlan *plan, Image *srcImage, Image *dstImage)
+{
+    if(srcImage->width!=plan->src_width || srcImage->height!=plan->src_height
+            || dstImage->width!=plan->dst_width || dstImage->height!=plan->dst_height
+            || srcImage->channels!=plan->channels || dstImage->channels!=plan->channels){
+        fprintf(stderr,"resample plan: images do not match the plan\n");
+        return false;
+    }
+    switch(plan->channels){
+    case 1:
+        ResamplePlanGather<1>(plan,srcImage->data,dstImage->data);
+        break;
+    case 3:
+        ResamplePlanGather<3>(plan,srcImage->data,dstImage->data);
+        break;
+    default:
+        fprintf(stderr,"resample plan: %d channels are not supported\n",plan->channels);
+        return false;
+    }
+    return true;
+}
+
+size_t ResamplePlanBytes(ResamplePlan *plan)
+{
+    return plan->first.size()*sizeof(uint32_t) + plan->index.size()*sizeof(uint32_t)
+            + plan->weights.size()*sizeof(float);
+}
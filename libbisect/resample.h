@@ -0,0 +1,121 @@
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+
+#include "bisectengine.h"
+#include "image.h"
+#include <stdint.h>
+#include <vector>
+
+//
+// Area sampled affine resampling. Each destination pixel is the average of
+// the source pixels under its footprint, weighted by the exact area of the
+// footprint that falls in each source pixel. M_inv maps destination
+// coordinates to source coordinates. Source pixels outside the image
+// contribute zero. Scales and flips, whose footprints are axis aligned
+// rectangles, go through ResampleSeparable. A projective M_inv maps each
+// destination pixel to a quad of its own, see d2project, and the pixels
+// reaching the horizon are black.
+//
+bool resample(Image *srcImage, Image *dstImage, glm::mat3 &M_inv);
+
+//
+// Running sums along the rows of an image, in double so that the
+// difference of two stays exact to well below the 8 bit output.
+// sums[(y*(width+1) + x)*channels + c] is the sum of pixels 0 to x-1 of
+// row y in channel c. The footprint rows are the spans, so sums along the
+// rows give the O(1) span sum of a summed-area table without differencing
+// sums over the whole image.
+//
+struct RowSumTable {
+    int width;
+    int height;
+    int channels;
+    std::vector<double> sums;
+};
+
+void RowSumTableInit(RowSumTable *table, Image *image);
+
+//
+// resample for minifying transforms. The pixels between the edges of a
+// footprint row all have area 1, their sum is read from the row sums of
+// the source in O(1) and only the pixels the edges pass through are
+// bisected, so the cost of a destination pixel grows with the perimeter
+// of its footprint, not its area. table holds the row sums of srcImage,
+// it costs about one plain resample to build and can be kept for any
+// number of transforms of the same source.
+//
+bool resampleSummed(Image *srcImage, RowSumTable *table, Image *dstImage, glm::mat3 &M_inv);
+
+//
+// resample for a transform with conformed steps along the axes, weights
+// applied as a horizontal and a vertical 1D pass
+//
+bool ResampleSeparable(Image *srcImage, Image *dstImage, glm::mat3 &M_inv);
+
+//
+// the conformed steps across the source for one destination pixel, false
+// if the transform can not be resampled
+//
+bool ResampleInitSteps(glm::mat3 &M_inv, glm::vec2 *v2_dsrcx, glm::vec2 *v2_dsrcy);
+
+//
+// resample from a mapped source straight into a PNM file, for sources and
+// destinations larger than memory. The destination is cut into square
+// tiles, as large as keeps the source rectangle under a tile within
+// max_bytes. Each tile reads only that rectangle from the map, is
+// resampled, with resampleSummed if summed is set, and written out
+// before the next one is started.
+//
+bool ResampleStream(ImageMap *srcMap, const char *output, int width, int height,
+                    glm::mat3 &M_inv, size_t max_bytes, bool summed);
+
+//
+// The weights of resample for one transform between images of fixed
+// sizes, for applying the same transform to many frames. The clipping is
+// done once by ResamplePlanInit, ResamplePlanApply is then a sparse
+// gather whose cost is the memory traffic of the weights and the source.
+// The weights of destination pixel i are index and weights
+// [first[i]..first[i+1]), in the order the engine covers the footprint.
+// index is the offset of the source pixel in floats, weights the covered
+// area divided by the area of the footprint. Pixels off the source are
+// left out. A projective M_inv is taken as by resample.
+//
+struct ResamplePlan {
+    int src_width;
+    int src_height;
+    int dst_width;
+    int dst_height;
+    int channels;
+    std::vector<uint32_t> first;    // dst_width*dst_height+1 entries
+    std::vector<uint32_t> index;
+    std::vector<float> weights;
+};
+
+bool ResamplePlanInit(ResamplePlan *plan, int src_width, int src_height, int dst_width,
+                      int dst_height, int channels, glm::mat3 &M_inv);
+bool ResamplePlanApply(ResamplePlan *plan, Image *srcImage, Image *dstImage);
+// the bytes held by the plan's arrays
+size_t ResamplePlanBytes(ResamplePlan *plan);
+
+//
+// The area the coverage of a footprint adds up to, over n pixels and
+// n_spans spans of covered pixels. The resamplers divide by it rather than
+// by the area of the footprint, so that area lost by the clipping does not
+// darken the destination pixel.
+//
+float ResampleCoveredArea(const PixelCoverage *coverage, int n, const CoverageSpan *spans, int n_spans);
+
+//
+// dst = sum(area*src)/covered_area over n covered pixels, offset by i2_base
+//
+void ResampleAccumulate(Image *srcImage, PixelCoverage *coverage, int n,
+                        glm::ivec2 i2_base, float covered_area, float *dst);
+
+//
+// dst += sum(src)/covered_area over n spans of covered pixels, offset by
+// i2_base
+//
+void ResampleAccumulateSpans(RowSumTable *table, CoverageSpan *spans, int n,
+                             glm::ivec2 i2_base, float covered_area, float *dst);
+
+#endif // RESAMPLE_H
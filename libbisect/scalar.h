@@ -0,0 +1,149 @@
+#ifndef SCALAR_H
+#define SCALAR_H
+
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <glm/glm.hpp>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+//
+// The scalar types the engine can be built on. The geometry only goes
+// through vec2 arithmetic and the functions of ScalarTraits, so float,
+// double and fixed point share one implementation.
+//
+
+//
+// 16.16 fixed point, 32 bits wide. Sums and differences are exact, a
+// product of two coordinates is kept in 64 bits by ScalarTraits<fixed32>
+// so the inside tests and the shoelace sums are exact integer arithmetic.
+// Coordinates have to stay within +-32767, and so does a product of two
+// taken by fixed32 operator*. There is no 64 bit type with 32.32
+// coordinates: its crossings would need products wider than the 128
+// bits ScalarTraits<fixed32>::Intersection works in.
+//
+#define FIXED_FRAC_BITS 16
+#define FIXED_ONE (1<<FIXED_FRAC_BITS)
+
+struct fixed32 {
+    int32_t raw;
+    fixed32() : raw(0) {}
+    explicit fixed32(int i) : raw(i*FIXED_ONE) {}
+    explicit fixed32(float f) : raw((int32_t)lrintf(f*(float)FIXED_ONE)) {}
+    explicit fixed32(double d) : raw((int32_t)lrint(d*(double)FIXED_ONE)) {}
+    static fixed32 FromRaw(int32_t raw){ fixed32 r; r.raw = raw; return r; }
+    float ToFloat() const { return (float)raw*(1.0f/(float)FIXED_ONE); }
+    fixed32 operator-() const { return FromRaw(-raw); }
+    fixed32 &operator+=(fixed32 b){ raw += b.raw; return *this; }
+    fixed32 &operator-=(fixed32 b){ raw -= b.raw; return *this; }
+};
+
+inline fixed32 operator+(fixed32 a, fixed32 b){ return fixed32::FromRaw(a.raw + b.raw); }
+inline fixed32 operator-(fixed32 a, fixed32 b){ return fixed32::FromRaw(a.raw - b.raw); }
+// rounded to the nearest, ties up
+inline fixed32 operator*(fixed32 a, fixed32 b)
+{
+    int64_t p = (int64_t)a.raw*b.raw + (FIXED_ONE>>1);
+    return fixed32::FromRaw((int32_t)(p>>FIXED_FRAC_BITS));
+}
+inline fixed32 operator/(fixed32 a, fixed32 b)
+{
+    return fixed32::FromRaw((int32_t)(((int64_t)a.raw*FIXED_ONE)/b.raw));
+}
+inline bool operator==(fixed32 a, fixed32 b){ return a.raw==b.raw; }
+inline bool operator!=(fixed32 a, fixed32 b){ return a.raw!=b.raw; }
+inline bool operator<(fixed32 a, fixed32 b){ return a.raw<b.raw; }
+inline bool operator>(fixed32 a, fixed32 b){ return a.raw>b.raw; }
+inline bool operator<=(fixed32 a, fixed32 b){ return a.raw<=b.raw; }
+inline bool operator>=(fixed32 a, fixed32 b){ return a.raw>=b.raw; }
+
+struct fixed2 {
+    fixed32 x, y;
+    fixed2() {}
+    fixed2(fixed32 a, fixed32 b) : x(a), y(b) {}
+    fixed2 &operator+=(fixed2 b){ x += b.x; y += b.y; return *this; }
+    fixed2 &operator-=(fixed2 b){ x -= b.x; y -= b.y; return *this; }
+};
+
+inline fixed2 operator+(fixed2 a, fixed2 b){ return fixed2(a.x+b.x,a.y+b.y); }
+inline fixed2 operator-(fixed2 a, fixed2 b){ return fixed2(a.x-b.x,a.y-b.y); }
+inline fixed2 operator*(fixed2 a, fixed32 s){ return fixed2(a.x*s,a.y*s); }
+inline bool operator==(fixed2 a, fixed2 b){ return a.x==b.x && a.y==b.y; }
+
+//
+// vec2 and the products of two coordinates for each scalar, and the few
+// operations that differ between floating and fixed point
+//
+template<typename T> struct ScalarTraits;
+
+template<typename T, typename V> struct FloatTraits {
+    typedef V vec2;
+    typedef T wide;
+    static vec2 FromFloat(glm::vec2 v){ return vec2(v); }
+    static glm::vec2 ToFloat(vec2 v){ return glm::vec2(v); }
+    static vec2 FromDouble(glm::dvec2 v){ return vec2(v); }
+    static vec2 FromInt(glm::ivec2 i){ return vec2((T)i.x,(T)i.y); }
+    static T FromFloat(float f){ return (T)f; }
+    static float ToFloat(T t){ return (float)t; }
+    static float WideToFloat(wide w){ return (float)w; }
+    static int Floor(T t){ return (int)floor(t); }
+    static int Trunc(T t){ return (int)t; }
+    static wide Dot(vec2 a, vec2 b){ return a.x*b.x + a.y*b.y; }
+    static wide Cross(vec2 a, vec2 b){ return a.x*b.y - a.y*b.x; }
+    // unit normals, so the limit is a distance
+    static vec2 EdgeNormal(vec2 v10){ return glm::normalize(vec2(-v10.y,v10.x)); }
+    // the midpoint is the same whichever way round the edge is walked,
+    // so two polygons sharing an edge get exactly opposite inside tests
+    static vec2 EdgeOrigin(vec2 v0, vec2 v1){ return (T)0.5*(v0 + v1); }
+    // infinite for an edge parallel to the axis of dy
+    static T Slope(T dx, T dy){ return dx/dy; }
+    static T MulDiv(T a, T b, T c){ return a*b/c; }
+};
+
+template<> struct ScalarTraits<float> : FloatTraits<float,glm::vec2> {
+    static const char *Name(){ return "float"; }
+    static wide InsideLimit(vec2){ return -1e-5f; }
+    static vec2 Intersection(vec2 a0, vec2 a1, vec2 b0, vec2 b10);
+};
+
+template<> struct ScalarTraits<double> : FloatTraits<double,glm::dvec2> {
+    static const char *Name(){ return "double"; }
+    static wide InsideLimit(vec2){ return -1e-9; }
+    static vec2 Intersection(vec2 a0, vec2 a1, vec2 b0, vec2 b10);
+};
+
+template<> struct ScalarTraits<fixed32> {
+    typedef fixed2 vec2;
+    typedef int64_t wide; // 32.32
+    static const char *Name(){ return "fixed"; }
+    static vec2 FromFloat(glm::vec2 v){ return vec2(fixed32(v.x),fixed32(v.y)); }
+    static glm::vec2 ToFloat(vec2 v){ return glm::vec2(v.x.ToFloat(),v.y.ToFloat()); }
+    static vec2 FromDouble(glm::dvec2 v){ return vec2(fixed32(v.x),fixed32(v.y)); }
+    static vec2 FromInt(glm::ivec2 i){ return vec2(fixed32(i.x),fixed32(i.y)); }
+    static fixed32 FromFloat(float f){ return fixed32(f); }
+    static float ToFloat(fixed32 t){ return t.ToFloat(); }
+    static float WideToFloat(wide w){ return (float)((double)w*(1.0/((double)FIXED_ONE*FIXED_ONE))); }
+    static int Floor(fixed32 t){ return t.raw>>FIXED_FRAC_BITS; }
+    static int Trunc(fixed32 t){ return t.raw/FIXED_ONE; }
+    static wide Dot(vec2 a, vec2 b){ return (int64_t)a.x.raw*b.x.raw + (int64_t)a.y.raw*b.y.raw; }
+    static wide Cross(vec2 a, vec2 b){ return (int64_t)a.x.raw*b.y.raw - (int64_t)a.y.raw*b.x.raw; }
+    // the normal is not normalised so the inside test stays exact, and the
+    // edge is measured from its start since v10 and N are exactly
+    // perpendicular
+    static vec2 EdgeNormal(vec2 v10){ return vec2(-v10.y,v10.x); }
+    static vec2 EdgeOrigin(vec2 v0, vec2){ return v0; }
+    // the crossings divide exactly by the edge vector, no slope is kept
+    static fixed32 Slope(fixed32, fixed32){ return fixed32(); }
+    // a*b/c with the product kept in 64 bits, a*b alone leaves the
+    // 16.16 range once both are above 181
+    static fixed32 MulDiv(fixed32 a, fixed32 b, fixed32 c){
+        return fixed32::FromRaw((int32_t)((int64_t)a.raw*b.raw/c.raw));
+    }
+    // a crossing is rounded to the nearest step, half a step off the edge
+    // in x and y
+    static wide InsideLimit(vec2 N){ return -((int64_t)abs(N.x.raw) + abs(N.y.raw))/2 - 1; }
+    static vec2 Intersection(vec2 a0, vec2 a1, vec2 b0, vec2 b10);
+};
+
+#endif // SCALAR_H
@@ -1,10 +1,15 @@
 #include "myglwidget.h"
+#include "emulate.h"
+#include <chrono>
 #include <math.h>
 #include <stdlib.h>
 
+#define VIEWER_CORPUS "/tmp/bisect.corpus"
+// destination width and height of the startup sweep
+#define SWEEP_SIZE 128
+
 MyGLWidget::MyGLWidget(QWidget *parent) :
-    QOpenGLWidget(parent),
-    theta_file("/tmp/theta.bin")
+    QOpenGLWidget(parent)
 {
     setFocusPolicy(Qt::ClickFocus);
     grabKeyboard();
@@ -13,6 +18,21 @@ MyGLWidget::MyGLWidget(QWidget *parent) :
     dalpha = 0.1/60.0;
     advance_i_fail = false;
     timer = new QTimer(this);
+    pixelBatch.n_indices = 0;
+    gridBatch.n_indices = 0;
+    srcPolygonBatch.n_indices = 0;
+    for(int i=0;i<3;i++){
+        pixelBatch.buffers[i] = 0;
+        gridBatch.buffers[i] = 0;
+        srcPolygonBatch.buffers[i] = 0;
+    }
+    // nothing has been built yet
+    for(int i=0;i<4;i++){
+        frame_vertices[i] = glm::vec2(NAN);
+    }
+    batch_grid_size = -1;
+    latest_frame = NULL;
+    stop_geometry = false;
 
     connect(timer, &QTimer::timeout, this, &MyGLWidget::timer_func);
 
@@ -28,44 +48,67 @@ MyGLWidget::MyGLWidget(QWidget *parent) :
     M = glm::rotate(M,-theta_glitch);
     M = glm::translate(M,-A);
 
-    M_inv = glm::inverse(M);
+    M_inv = TransformNormalize(glm::inverse(M));
 
-    EmulateTransform(128,128,M_inv);
+    // the steps of the failures of the sweep
+    engine.InitTransform(M_inv);
+    // the viewer draws every pixel of the grid
+    engine.edge_walk = false;
 
     i_fail = 0;
+    title_rows = -1;
+    EmulateProgressInit(&sweep_progress);
 
-    theta_file_open = false;
-    if(theta_file.open(QIODevice::ReadOnly)){
-        // check the size
-        if(theta_file.size()>0){
-            theta_file_write = false;
-            theta_file_open = true;
-            qDebug("theta_file open for reading.\n");
-        }else{
-            theta_file.close();
-        }
-    }
-    if(!theta_file_open){
-        // open for writing
-        if(theta_file.open(QIODevice::WriteOnly)){
-            theta_file_write = true;
-            theta_file_open = true;
-            qDebug("theta_file open for writing.\n");
-        }
-    }
-    if(!theta_file_open){
-        qDebug("theta_file not open\n");
+    //
+    // the failures stepped through with the space bar are the records of
+    // the corpus if there is one, otherwise the failures of a sweep of the
+    // glitch transform. The sweep runs in the background, its failures can
+    // be browsed as soon as they are found and are recorded in a new corpus
+    // once it has finished.
+    //
+    corpus_open = CorpusOpen(&corpus,VIEWER_CORPUS);
+    if(corpus_open){
+        qDebug("corpus open, %llu records.\n",(unsigned long long)corpus.n_records);
+    }else{
+        sweep_progress.failures = SweepFailures;
+        sweep_progress.user = this;
+        sweep_thread = std::thread(&MyGLWidget::SweepThread,this);
     }
 
+    geometry_thread = std::thread(&MyGLWidget::GeometryThread,this);
     timer->start(1000/60);
 
 }
 
+MyGLWidget::~MyGLWidget()
+{
+    sweep_progress.cancel = true;
+    if(sweep_thread.joinable()){
+        sweep_thread.join();
+    }
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        stop_geometry = true;
+    }
+    wake.notify_one();
+    geometry_thread.join();
+    delete latest_frame.exchange(NULL);
+    makeCurrent();
+    BatchFree(&pixelBatch);
+    BatchFree(&gridBatch);
+    BatchFree(&srcPolygonBatch);
+    doneCurrent();
+}
+
 void MyGLWidget::initializeGL(){
     initializeOpenGLFunctions();
 
     glMatrixMode(GL_MODELVIEW);
     glLoadIdentity();
+
+    BatchInit(&pixelBatch,GL_TRIANGLES);
+    BatchInit(&gridBatch,GL_LINES);
+    BatchInit(&srcPolygonBatch,GL_LINES);
 }
 
 void MyGLWidget::resizeGL(int w, int h){
@@ -77,12 +120,25 @@ void MyGLWidget::resizeGL(int w, int h){
 }
 
 void MyGLWidget::paintGL(){
-    InitSrcPolygon();
-    InitPixels();
+    //
+    // a new frame from the geometry thread replaces the batches, otherwise
+    // the last one is drawn again straight from the buffers
+    //
+    ViewerFrame *frame = latest_frame.exchange(NULL);
+    if(frame){
+        BatchUpload(&pixelBatch,&frame->pixels);
+        BatchUpload(&srcPolygonBatch,&frame->srcPolygon);
+        if(frame->grid_size!=batch_grid_size){
+            BatchUpload(&gridBatch,&frame->grid);
+            batch_grid_size = frame->grid_size;
+        }
+        delete frame;
+    }
+    if(batch_grid_size<0) return;
     glMatrixMode(GL_PROJECTION);
     glLoadIdentity();
     GLdouble aspect = (GLdouble)width/height;
-    GLdouble size = (float)grid_size;
+    GLdouble size = (float)batch_grid_size;
     if(aspect>=1.0){
         GLdouble left = -aspect*size/2 + size/2;
         GLdouble right = aspect*size/2 + size/2;
@@ -100,22 +156,22 @@ void MyGLWidget::paintGL(){
         GLdouble far = -1.0;
         glOrtho(left,right,bottom,top,near,far);
     }
-    glColor3f(0.25f,0.25f,0.25f);
-    DrawGrid();
-
-    glColor3f(0.5f,0.5f,0.5f);
-    BisectAndDrawPixels();
-    DrawSrcPolygon();
-    alpha += dalpha;
-    if(alpha>=1.0f)alpha-=1.0f;
-
+    BatchDraw(&gridBatch);
+    BatchDraw(&pixelBatch);
+    BatchDraw(&srcPolygonBatch);
 }
 
 void MyGLWidget::keyPressEvent(QKeyEvent *event)
 {
     switch(event->key()){
-    case Qt::Key_Space:
+    case Qt::Key_Space:{
+        std::lock_guard<std::mutex> lock(wake_mutex);
         advance_i_fail = true;
+        wake.notify_one();
+        break;
+    }
+    case Qt::Key_Escape:
+        sweep_progress.cancel = true;
         break;
     default:
         QOpenGLWidget::keyPressEvent(event);
@@ -123,7 +179,11 @@ void MyGLWidget::keyPressEvent(QKeyEvent *event)
     }
 }
 
-void MyGLWidget::InitSrcPolygon()
+//
+// the source polygon of this tick, true if it follows the animation and
+// false if it is a failure that stays until the space bar is pressed
+//
+bool MyGLWidget::InitSrcPolygon()
 {
     glm::vec2 vertices[4] = {
         glm::vec2(0.0f,0.0f),
@@ -133,12 +193,6 @@ void MyGLWidget::InitSrcPolygon()
     };
 
     glm::mat3 M(1.0f);
-    if(theta_file_open && !theta_file_write){
-        theta_file.read((char*)&alpha,sizeof(alpha));
-        if(theta_file.atEnd()){
-            theta_file.seek(0);
-        }
-    }
 
     theta = 2.0*M_PI*alpha;
 
@@ -190,755 +244,233 @@ void MyGLWidget::InitSrcPolygon()
     M = glm::rotate(M, theta_glitch);
     M = glm::scale(M,glm::vec2(1.0f/3.0f,3.0f));
     M = glm::rotate(M,-theta_glitch);
-    M = glm::inverse(M);
-
-    if(fail_vector.empty()){
-        SrcPolygonInitVertices(&srcPolygon, vertices, M);
+    M = TransformNormalize(glm::inverse(M));
+
+    SrcPolygon *srcPolygon = &engine.srcPolygon;
+    bool from_corpus = corpus_open && corpus.n_records;
+    size_t n_fail;
+    glm::vec2 v2_fail;
+    if(from_corpus){
+        n_fail = corpus.n_records;
     }else{
-        glm::vec2 v2_src00 = fail_vector[i_fail];
-        srcPolygon.vertices[0].v0 = v2_src00;
-        srcPolygon.vertices[1].v0 = v2_src00 + v2_dsrcy;
-        srcPolygon.vertices[2].v0 = v2_src00 + v2_dsrcy + v2_dsrcx;
-        srcPolygon.vertices[3].v0 = v2_src00 + v2_dsrcx;
-        if(advance_i_fail){
-            i_fail++;
-            if(i_fail==fail_vector.size())i_fail=0;
-            advance_i_fail = false;
+        std::lock_guard<std::mutex> lock(fail_mutex);
+        n_fail = sweep_fails.size();
+        if(n_fail) v2_fail = sweep_fails[i_fail];
+    }
+    const CorpusTransform *transform = NULL;
+    if(from_corpus){
+        transform = CorpusRecordTransform(&corpus,i_fail);
+    }
+    bool animated = n_fail==0 || (from_corpus && !transform);
+    if(animated){
+        SrcPolygonInitVertices(srcPolygon, vertices, M);
+        SrcPolygonInitEdges(srcPolygon);
+    }else if(from_corpus){
+        //
+        // a record is placed the way CorpusReplayRecord places it: a
+        // perspective pixel gets its own quad, otherwise the steps are
+        // swapped for a mirrored transform
+        //
+        const CorpusRecord *record = &corpus.records[i_fail];
+        glm::mat3 M_record = CorpusTransformMatrix(transform);
+        engine.v2_dsrcx = glm::vec2(transform->dsrcx[0],transform->dsrcx[1]);
+        engine.v2_dsrcy = glm::vec2(transform->dsrcy[0],transform->dsrcy[1]);
+        if(!TransformProjective(M_record) || !engine.InitQuad(M_record,record->x,record->y)){
+            engine.InitPolygon(glm::vec2(record->src00[0],record->src00[1]),
+                               engine.v2_dsrcx,engine.v2_dsrcy);
         }
+    }else{
+        engine.InitPolygon(v2_fail,engine.v2_dsrcx,engine.v2_dsrcy);
     }
-
-    SrcPolygonInitEdges(&srcPolygon);
-
+    if(n_fail && advance_i_fail.exchange(false)){
+        i_fail++;
+        if(i_fail==n_fail)i_fail=0;
+    }
+    return animated;
 }
 
-void MyGLWidget::InitPixels()
+//
+// the geometry is filled a vertex at a time, a fan of triangles covers a
+// convex polygon
+//
+static void BatchAddVertex(BatchGeometry *batch, glm::vec2 v, const GLfloat *color)
 {
-    glm::ivec2 i2_src0 = convert_ivec2_plus(srcPolygon.vertices[0].v0);
-    glm::ivec2 i2_src1 = convert_ivec2_plus(srcPolygon.vertices[1].v0);
-    glm::ivec2 i2_src2 = convert_ivec2_plus(srcPolygon.vertices[2].v0);
-    glm::ivec2 i2_src3 = convert_ivec2_plus(srcPolygon.vertices[3].v0);
-
-    glm::ivec2 i2_min = glm::min(glm::min(i2_src0,i2_src1),glm::min(i2_src2,i2_src3));
-    glm::ivec2 i2_max = glm::max(glm::max(i2_src0,i2_src1),glm::max(i2_src2,i2_src3));
-
-    Npixelx = i2_max.x - i2_min.x + 1;
-    Npixely = i2_max.y - i2_min.y + 1;
-
-    glm::ivec2 i2_v0(i2_min.x,i2_max.y);
-    glm::vec2 v0 = i2_v0;
-
-    grid_size = (Npixelx>Npixely)?Npixelx:Npixely;
-    if(grid_size<3) grid_size = 3;
-
-    if(Npixelx==1 && Npixely==1){
-        pixelVertices[0][0].v = v0;
-        return;
-    }
-
-    PixelVertex *pixelVertex = &pixelVertices[0][0];
-    int x;
-    int y;
-    for(y=0;y<Npixely+1;y++){
-        glm::vec2 v = v0;
-        for(x=0;x<Npixelx+1;x++,pixelVertex++){
-            pixelVertex->v = v;
-            pixelVertex->inside = f2BisectSrcPolygon(&srcPolygon, v);
-            v+=glm::vec2(1.0f,0.0f);
-        }
-        // move the pointer to the next line
-        pixelVertex+=(GRID_SIZE+1) - x;
-        v0+=glm::vec2(0.0f,-1.0f);
-    }
-    // initialize the pixel vertex flags to zero
-    int *pixelVFlag = &pixelVFlags[0][0];
-    for(int y=0;y<Npixely;y++){
-        int x;
-        for(x=0;x<Npixelx;x++,pixelVFlag++){
-            *pixelVFlag = 0;
-        }
-        pixelVFlag += GRID_SIZE - x;
-    }
-    // deposit the vertices into the pixels
-    pixelVFlags[i2_v0.y-i2_src0.y][i2_src0.x-i2_v0.x] |= V0_BIT;
-    pixelVFlags[i2_v0.y-i2_src1.y][i2_src1.x-i2_v0.x] |= V1_BIT;
-    pixelVFlags[i2_v0.y-i2_src2.y][i2_src2.x-i2_v0.x] |= V2_BIT;
-    pixelVFlags[i2_v0.y-i2_src3.y][i2_src3.x-i2_v0.x] |= V3_BIT;
+    batch->vertices.push_back(v);
+    batch->colors.push_back(glm::vec3(color[0],color[1],color[2]));
 }
 
-void MyGLWidget::BisectAndDrawPixels(void){
-    PixelVertex *pixel00 = &pixelVertices[0][0];
-    PixelVertex *pixel10 = &pixelVertices[0][1];
-    PixelVertex *pixel01 = &pixelVertices[1][0];
-    PixelVertex *pixel11 = &pixelVertices[1][1];
-    PixelEdge *xEdgeTop = &xEdges[0][0];
-    PixelEdge *xEdgeBottom = &xEdges[1][0];
-    PixelEdge *yEdgeLeft = &yEdges[0][0];
-    PixelEdge *yEdgeRight = &yEdges[0][1];
-    glm::vec2 origin = pixelVertices[0][0].v;
-    glm::vec2 v;
-    int x;
-    int y;
-    GLfloat even_colors[3]={0.5f,0.5f,0.25f};
-    GLfloat odd_colors[3]={0.25f,0.25f,0.5f};
-    if(Npixelx==1 && Npixely==1){
-        // source polygon is completely within pixel (0,0)
-        // draw the vertices of the source polygon
-        glColor3fv(even_colors);
-        glBegin(GL_POLYGON);
-        v = srcPolygon.vertices[0].v0 - origin;
-        glVertex2f(v.x,v.y);
-        v = srcPolygon.vertices[1].v0 - origin;
-        glVertex2f(v.x,v.y);
-        v = srcPolygon.vertices[2].v0 - origin;
-        glVertex2f(v.x,v.y);
-        v = srcPolygon.vertices[3].v0 - origin;
-        glVertex2f(v.x,v.y);
-        glEnd();
-        return;
-    }
-    float src_area = SrcPolygonArea(&srcPolygon);
-    float total_area = 0.0f;
-    for(y=0;y<Npixely;y++){
-        for(x=0;x<Npixelx;x++,pixel00++,pixel01++,pixel10++,pixel11++,xEdgeTop++,
-            xEdgeBottom++,yEdgeLeft++,yEdgeRight++){
-            //
-            // bisect the new edges
-            //
-            // test for the top of the grid
-            //
-            if(y==0){
-                xEdgeTop->code = 0;
-                xEdgeTop->v_ends[0] = pixel00->v;
-                xEdgeTop->inside_ends[0] = pixel00->inside;
-                xEdgeTop->v_ends[1] = pixel10->v;
-                xEdgeTop->inside_ends[1] = pixel10->inside;
-                PixelEdgeBorderBisectSrcPolygon(xEdgeTop,&srcPolygon);
-            }
-            //
-            // test for the left most edge
-            //
-            if(x==0){
-                yEdgeLeft->code = 0;
-                yEdgeLeft->v_ends[0] = pixel00->v;
-                yEdgeLeft->inside_ends[0] = pixel00->inside;
-                yEdgeLeft->v_ends[1] = pixel01->v;
-                yEdgeLeft->inside_ends[1] = pixel01->inside;
-                PixelEdgeBorderBisectSrcPolygon(yEdgeLeft,&srcPolygon);
-            }
-            //
-            // bisect the fresh bottom edge
-            //
-            xEdgeBottom->code = 0;
-            xEdgeBottom->v_ends[0] = pixel01->v;
-            xEdgeBottom->inside_ends[0] = pixel01->inside;
-            xEdgeBottom->v_ends[1] = pixel11->v;
-            xEdgeBottom->inside_ends[1] = pixel11->inside;
-            if(y<(Npixely-1)){
-                PixelEdgeBisectSrcPolygon(xEdgeBottom,&srcPolygon);
-            }else{
-                PixelEdgeBorderBisectSrcPolygon(xEdgeBottom,&srcPolygon);
-            }
-            //
-            // initialize the right edge
-            //
-            yEdgeRight->code = 0;
-            yEdgeRight->v_ends[0] = pixel10->v;
-            yEdgeRight->inside_ends[0] = pixel10->inside;
-            yEdgeRight->v_ends[1] = pixel11->v;
-            yEdgeRight->inside_ends[1] = pixel11->inside;
-            if(x<(Npixelx-1)){
-                PixelEdgeBisectSrcPolygon(yEdgeRight,&srcPolygon);
-            }else{
-                PixelEdgeBorderBisectSrcPolygon(yEdgeRight,&srcPolygon);
-            }
-            //
-            // now draw the pixel
-            //
-            if(y&1){
-                if(x&1){
-                    glColor3fv(even_colors);
-                }else{
-                    glColor3fv(odd_colors);
-                }
-            }else{
-                if(x&1){
-                    glColor3fv(odd_colors);
-                }else{
-                    glColor3fv(even_colors);
-                }
-            }
-            polygon.N = 0;
-            int pixelVFlag = pixelVFlags[y][x];
-            if(pixelVFlag==0b0001 || pixelVFlag==0b0010
-                    || pixelVFlag==0b0100 || pixelVFlag==0b1000
-                    || pixelVFlag==0b0101 || pixelVFlag==0b1010){
-                //
-                // single vertex in the pixel
-                //
-                PolygonAddEdgeSingleVertexForward(&polygon,yEdgeLeft,pixelVFlag,&srcPolygon);
-                PolygonAddEdgeSingleVertexForward(&polygon,xEdgeBottom,pixelVFlag,&srcPolygon);
-                PolygonAddEdgeSingleVertexReverse(&polygon,yEdgeRight,pixelVFlag,&srcPolygon);
-                PolygonAddEdgeSingleVertexReverse(&polygon,xEdgeTop,pixelVFlag,&srcPolygon);
-            }else{
-                // vertices in the pixel are drawn all at once
-                bool iv_drawn = false;
-                //
-                // draw the left edge
-                //
-                switch(yEdgeLeft->code){
-                case 0:
-                    if(yEdgeLeft->inside_ends[0]==0b1111){
-                        PolygonAddVertex(&polygon,yEdgeLeft->v_ends[0]);
-                    }else{
-                        PolygonAddMultiVFlag(&polygon, pixelVFlag, &srcPolygon);
-                        iv_drawn = true;
-                    }
-                    break;
-                case 1:
-                    PolygonAddVertex(&polygon,yEdgeLeft->v_ends[0]);
-                    PolygonAddVertex(&polygon,yEdgeLeft->v_edge[1]);
-                    break;
-                case 2:
-                    PolygonAddVertex(&polygon,yEdgeLeft->v_edge[0]);
-                    break;
-                case 3:
-                    PolygonAddVertex(&polygon,yEdgeLeft->v_edge[0]);
-                    PolygonAddVertex(&polygon,yEdgeLeft->v_edge[1]);
-                    break;
-                }
-                //
-                // draw the bottom edge
-                //
-                switch(xEdgeBottom->code){
-                case 0:
-                    if(xEdgeBottom->inside_ends[0]==0b1111){
-                        PolygonAddVertex(&polygon,xEdgeBottom->v_ends[0]);
-                    }else{
-                        if(!iv_drawn){
-                            PolygonAddMultiVFlag(&polygon, pixelVFlag, &srcPolygon);
-                            iv_drawn = true;
-                        }
-                    }
-                    break;
-                case 1:
-                    PolygonAddVertex(&polygon,xEdgeBottom->v_ends[0]);
-                    PolygonAddVertex(&polygon,xEdgeBottom->v_edge[1]);
-                    break;
-                case 2:
-                    PolygonAddVertex(&polygon,xEdgeBottom->v_edge[0]);
-                    break;
-                case 3:
-                    PolygonAddVertex(&polygon,xEdgeBottom->v_edge[0]);
-                    PolygonAddVertex(&polygon,xEdgeBottom->v_edge[1]);
-                    break;
-                }
-                //
-                // draw the right edge - it's in the reverse direction to
-                // the drawing order
-                //
-                switch(yEdgeRight->code){
-                case 0:
-                    if(yEdgeRight->inside_ends[1]==0b1111){
-                        PolygonAddVertex(&polygon,yEdgeRight->v_ends[1]);
-                    }else{
-                        if(!iv_drawn){
-                            PolygonAddMultiVFlag(&polygon, pixelVFlag, &srcPolygon);
-                            iv_drawn = true;
-                        }
-                    }
-                    break;
-                case 1:
-                    PolygonAddVertex(&polygon,yEdgeRight->v_edge[1]);
-                    break;
-                case 2:
-                    PolygonAddVertex(&polygon,yEdgeRight->v_ends[1]);
-                    PolygonAddVertex(&polygon,yEdgeRight->v_edge[0]);
-                    break;
-                case 3:
-                    PolygonAddVertex(&polygon,yEdgeRight->v_edge[1]);
-                    PolygonAddVertex(&polygon,yEdgeRight->v_edge[0]);
-                    break;
-                }
-                //
-                // draw the top edge - it's in the reverse direction
-                // as well
-                //
-                switch(xEdgeTop->code){
-                case 0:
-                    if(xEdgeTop->inside_ends[1]==0b1111){
-                        PolygonAddVertex(&polygon,xEdgeTop->v_ends[1]);
-                    }else{
-                        if(!iv_drawn){
-                            PolygonAddMultiVFlag(&polygon, pixelVFlag, &srcPolygon);
-                            iv_drawn = true;
-                        }
-                    }
-                    break;
-                case 1:
-                    PolygonAddVertex(&polygon,xEdgeTop->v_edge[1]);
-                    break;
-                case 2:
-                    PolygonAddVertex(&polygon,xEdgeTop->v_ends[1]);
-                    PolygonAddVertex(&polygon,xEdgeTop->v_edge[0]);
-                    break;
-                case 3:
-                    PolygonAddVertex(&polygon,xEdgeTop->v_edge[1]);
-                    PolygonAddVertex(&polygon,xEdgeTop->v_edge[0]);
-                    break;
-                }
-
-            }
-            DrawPolygon();
-            total_area += PolygonArea(&polygon);
-        }
-        //
-        // advance the pointers to the next line
-        //
-        int offset = (GRID_SIZE+1) - x;
-        pixel00 += offset;
-        pixel01 += offset;
-        pixel10 += offset;
-        pixel11 += offset;
-        yEdgeLeft += offset;
-        yEdgeRight += offset;
-        offset = GRID_SIZE - x;
-        xEdgeTop += offset;
-        xEdgeBottom += offset;
-    }
-    float area_error = (total_area - src_area)/src_area;
-    if(fabsf(area_error)>0.05f){
-        qDebug("area_error:%f",area_error);
-//        if(theta_file.openMode()==QIODevice::WriteOnly){
-//            theta_file.write((char*)&alpha,sizeof(alpha));
-//        }
+static void BatchAddFan(BatchGeometry *batch, GLuint first, int n)
+{
+    for(int i=1;i+1<n;i++){
+        batch->indices.push_back(first);
+        batch->indices.push_back(first + i);
+        batch->indices.push_back(first + i + 1);
     }
 }
 
-bool MyGLWidget::BisectAndVerifyPixels()
+static void BatchAddLine(BatchGeometry *batch, glm::vec2 v0, glm::vec2 v1, const GLfloat *color)
 {
-    PixelVertex *pixel00 = &pixelVertices[0][0];
-    PixelVertex *pixel10 = &pixelVertices[0][1];
-    PixelVertex *pixel01 = &pixelVertices[1][0];
-    PixelVertex *pixel11 = &pixelVertices[1][1];
-    PixelEdge *xEdgeTop = &xEdges[0][0];
-    PixelEdge *xEdgeBottom = &xEdges[1][0];
-    PixelEdge *yEdgeLeft = &yEdges[0][0];
-    PixelEdge *yEdgeRight = &yEdges[0][1];
-    int x;
-    int y;
-    if(Npixelx==1 && Npixely==1){
-        return true;
-    }
-    float src_area = SrcPolygonArea(&srcPolygon);
-    float total_area = 0.0f;
-    for(y=0;y<Npixely;y++){
-        for(x=0;x<Npixelx;x++,pixel00++,pixel01++,pixel10++,pixel11++,xEdgeTop++,
-            xEdgeBottom++,yEdgeLeft++,yEdgeRight++){
-            //
-            // bisect the new edges
-            //
-            // test for the top of the grid
-            //
-            if(y==0){
-                xEdgeTop->code = 0;
-                xEdgeTop->v_ends[0] = pixel00->v;
-                xEdgeTop->inside_ends[0] = pixel00->inside;
-                xEdgeTop->v_ends[1] = pixel10->v;
-                xEdgeTop->inside_ends[1] = pixel10->inside;
-                PixelEdgeBorderBisectSrcPolygon(xEdgeTop,&srcPolygon);
-            }
-            //
-            // test for the left most edge
-            //
-            if(x==0){
-                yEdgeLeft->code = 0;
-                yEdgeLeft->v_ends[0] = pixel00->v;
-                yEdgeLeft->inside_ends[0] = pixel00->inside;
-                yEdgeLeft->v_ends[1] = pixel01->v;
-                yEdgeLeft->inside_ends[1] = pixel01->inside;
-                PixelEdgeBorderBisectSrcPolygon(yEdgeLeft,&srcPolygon);
-            }
-            //
-            // bisect the fresh bottom edge
-            //
-            xEdgeBottom->code = 0;
-            xEdgeBottom->v_ends[0] = pixel01->v;
-            xEdgeBottom->inside_ends[0] = pixel01->inside;
-            xEdgeBottom->v_ends[1] = pixel11->v;
-            xEdgeBottom->inside_ends[1] = pixel11->inside;
-            if(y<(Npixely-1)){
-                PixelEdgeBisectSrcPolygon(xEdgeBottom,&srcPolygon);
-            }else{
-                PixelEdgeBorderBisectSrcPolygon(xEdgeBottom,&srcPolygon);
-            }
-            //
-            // initialize the right edge
-            //
-            yEdgeRight->code = 0;
-            yEdgeRight->v_ends[0] = pixel10->v;
-            yEdgeRight->inside_ends[0] = pixel10->inside;
-            yEdgeRight->v_ends[1] = pixel11->v;
-            yEdgeRight->inside_ends[1] = pixel11->inside;
-            if(x<(Npixelx-1)){
-                PixelEdgeBisectSrcPolygon(yEdgeRight,&srcPolygon);
-            }else{
-                PixelEdgeBorderBisectSrcPolygon(yEdgeRight,&srcPolygon);
-            }
-            //
-            // now create the polygon for this pixel
-            //
-            polygon.N = 0;
-            int pixelVFlag = pixelVFlags[y][x];
-            if(pixelVFlag==0b0001 || pixelVFlag==0b0010
-                    || pixelVFlag==0b0100 || pixelVFlag==0b1000
-                    || pixelVFlag==0b0101 || pixelVFlag==0b1010){
-                //
-                // single vertex in the pixel
-                //
-                PolygonAddEdgeSingleVertexForward(&polygon,yEdgeLeft,pixelVFlag,&srcPolygon);
-                PolygonAddEdgeSingleVertexForward(&polygon,xEdgeBottom,pixelVFlag,&srcPolygon);
-                PolygonAddEdgeSingleVertexReverse(&polygon,yEdgeRight,pixelVFlag,&srcPolygon);
-                PolygonAddEdgeSingleVertexReverse(&polygon,xEdgeTop,pixelVFlag,&srcPolygon);
-            }else{
-                // vertices in the pixel are drawn all at once
-                bool iv_drawn = false;
-                //
-                // draw the left edge
-                //
-                switch(yEdgeLeft->code){
-                case 0:
-                    if(yEdgeLeft->inside_ends[0]==0b1111){
-                        PolygonAddVertex(&polygon,yEdgeLeft->v_ends[0]);
-                    }else{
-                        PolygonAddMultiVFlag(&polygon, pixelVFlag, &srcPolygon);
-                        iv_drawn = true;
-                    }
-                    break;
-                case 1:
-                    PolygonAddVertex(&polygon,yEdgeLeft->v_ends[0]);
-                    PolygonAddVertex(&polygon,yEdgeLeft->v_edge[1]);
-                    break;
-                case 2:
-                    PolygonAddVertex(&polygon,yEdgeLeft->v_edge[0]);
-                    break;
-                case 3:
-                    PolygonAddVertex(&polygon,yEdgeLeft->v_edge[0]);
-                    PolygonAddVertex(&polygon,yEdgeLeft->v_edge[1]);
-                    break;
-                }
-                //
-                // draw the bottom edge
-                //
-                switch(xEdgeBottom->code){
-                case 0:
-                    if(xEdgeBottom->inside_ends[0]==0b1111){
-                        PolygonAddVertex(&polygon,xEdgeBottom->v_ends[0]);
-                    }else{
-                        if(!iv_drawn){
-                            PolygonAddMultiVFlag(&polygon, pixelVFlag, &srcPolygon);
-                            iv_drawn = true;
-                        }
-                    }
-                    break;
-                case 1:
-                    PolygonAddVertex(&polygon,xEdgeBottom->v_ends[0]);
-                    PolygonAddVertex(&polygon,xEdgeBottom->v_edge[1]);
-                    break;
-                case 2:
-                    PolygonAddVertex(&polygon,xEdgeBottom->v_edge[0]);
-                    break;
-                case 3:
-                    PolygonAddVertex(&polygon,xEdgeBottom->v_edge[0]);
-                    PolygonAddVertex(&polygon,xEdgeBottom->v_edge[1]);
-                    break;
-                }
-                //
-                // draw the right edge - it's in the reverse direction to
-                // the drawing order
-                //
-                switch(yEdgeRight->code){
-                case 0:
-                    if(yEdgeRight->inside_ends[1]==0b1111){
-                        PolygonAddVertex(&polygon,yEdgeRight->v_ends[1]);
-                    }else{
-                        if(!iv_drawn){
-                            PolygonAddMultiVFlag(&polygon, pixelVFlag, &srcPolygon);
-                            iv_drawn = true;
-                        }
-                    }
-                    break;
-                case 1:
-                    PolygonAddVertex(&polygon,yEdgeRight->v_edge[1]);
-                    break;
-                case 2:
-                    PolygonAddVertex(&polygon,yEdgeRight->v_ends[1]);
-                    PolygonAddVertex(&polygon,yEdgeRight->v_edge[0]);
-                    break;
-                case 3:
-                    PolygonAddVertex(&polygon,yEdgeRight->v_edge[1]);
-                    PolygonAddVertex(&polygon,yEdgeRight->v_edge[0]);
-                    break;
-                }
-                //
-                // draw the top edge - it's in the reverse direction
-                // as well
-                //
-                switch(xEdgeTop->code){
-                case 0:
-                    if(xEdgeTop->inside_ends[1]==0b1111){
-                        PolygonAddVertex(&polygon,xEdgeTop->v_ends[1]);
-                    }else{
-                        if(!iv_drawn){
-                            PolygonAddMultiVFlag(&polygon, pixelVFlag, &srcPolygon);
-                            iv_drawn = true;
-                        }
-                    }
-                    break;
-                case 1:
-                    PolygonAddVertex(&polygon,xEdgeTop->v_edge[1]);
-                    break;
-                case 2:
-                    PolygonAddVertex(&polygon,xEdgeTop->v_ends[1]);
-                    PolygonAddVertex(&polygon,xEdgeTop->v_edge[0]);
-                    break;
-                case 3:
-                    PolygonAddVertex(&polygon,xEdgeTop->v_edge[1]);
-                    PolygonAddVertex(&polygon,xEdgeTop->v_edge[0]);
-                    break;
-                }
-
-            }
-            total_area += PolygonArea(&polygon);
-        }
-        //
-        // advance the pointers to the next line
-        //
-        int offset = (GRID_SIZE+1) - x;
-        pixel00 += offset;
-        pixel01 += offset;
-        pixel10 += offset;
-        pixel11 += offset;
-        yEdgeLeft += offset;
-        yEdgeRight += offset;
-        offset = GRID_SIZE - x;
-        xEdgeTop += offset;
-        xEdgeBottom += offset;
-    }
-    float area_error = (total_area - src_area)/src_area;
-    if(fabsf(area_error)>0.001f){
-        qDebug("verify area_error:%f",area_error);
-        return false;
-    }
-    return true;
+    GLuint first = (GLuint)batch->vertices.size();
+    BatchAddVertex(batch,v0,color);
+    BatchAddVertex(batch,v1,color);
+    batch->indices.push_back(first);
+    batch->indices.push_back(first + 1);
 }
 
-glm::vec2 v2conform_axis(glm::vec2 v){
-    glm::vec2 v_abs = glm::abs(v);
-    if(v_abs.x>=v_abs.y){
-        float tan_theta = v_abs.y/v_abs.x;
-        if(tan_theta < 1e-3){
-            v_abs.y=0;
-        }
-    }else{
-        float tan_theta = v_abs.x/v_abs.y;
-        if(tan_theta < 1e-3){
-            v_abs.x=0;
-        }
-    }
-    return v_abs * glm::sign(v);
+void MyGLWidget::BatchInit(GLBatch *batch, GLenum mode)
+{
+    batch->mode = mode;
+    batch->n_indices = 0;
+    glGenBuffers(3,batch->buffers);
 }
 
-
-void MyGLWidget::EmulateTransform(int width, int height, glm::mat3 &M_inv)
+void MyGLWidget::BatchUpload(GLBatch *batch, const BatchGeometry *geometry)
 {
-    glm::vec3 v3_dx(1.0f,0.0f,0.0f);
-    glm::vec3 v3_dy(0.0f,-1.0f,0.0f);
-    v2_dsrcx = v2conform_axis(glm::vec2(M_inv*v3_dx));
-    v2_dsrcy = v2conform_axis(glm::vec2(M_inv*v3_dy));
-
-    for(int y=0;y<height;y++){
-        glm::vec3 v3_y(0.0f,-(float)y,1.0f);
-        glm::vec2 v2_src00(M_inv*v3_y);
-        for(int x=0;x<width;x++,v2_src00+=v2_dsrcx){
-            srcPolygon.vertices[0].v0 = v2_src00;
-            srcPolygon.vertices[1].v0 = v2_src00 + v2_dsrcy;
-            srcPolygon.vertices[2].v0 = v2_src00 + v2_dsrcy + v2_dsrcx;
-            srcPolygon.vertices[3].v0 = v2_src00 + v2_dsrcx;
-
-            SrcPolygonInitEdges(&srcPolygon);
-            InitPixels();
-            if(!BisectAndVerifyPixels()){
-                qDebug("pixel failed x:%d y:%d",x,y);
-                fail_vector.push_back(v2_src00);
-            }
-        }
+    glBindBuffer(GL_ARRAY_BUFFER,batch->buffers[0]);
+    glBufferData(GL_ARRAY_BUFFER,geometry->vertices.size()*sizeof(glm::vec2),
+                 geometry->vertices.data(),GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER,batch->buffers[1]);
+    glBufferData(GL_ARRAY_BUFFER,geometry->colors.size()*sizeof(glm::vec3),
+                 geometry->colors.data(),GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER,0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,batch->buffers[2]);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,geometry->indices.size()*sizeof(GLuint),
+                 geometry->indices.data(),GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,0);
+    batch->n_indices = (GLsizei)geometry->indices.size();
+}
+
+void MyGLWidget::BatchDraw(GLBatch *batch)
+{
+    if(batch->n_indices==0) return;
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER,batch->buffers[0]);
+    glVertexPointer(2,GL_FLOAT,0,NULL);
+    glBindBuffer(GL_ARRAY_BUFFER,batch->buffers[1]);
+    glColorPointer(3,GL_FLOAT,0,NULL);
+    glBindBuffer(GL_ARRAY_BUFFER,0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,batch->buffers[2]);
+    glDrawElements(batch->mode,batch->n_indices,GL_UNSIGNED_INT,NULL);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,0);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+void MyGLWidget::BatchFree(GLBatch *batch)
+{
+    // the buffers only exist once initializeGL has run
+    if(batch->buffers[0]){
+        glDeleteBuffers(3,batch->buffers);
     }
 }
 
-
-void MyGLWidget::PolygonAddSingleVFlag(Polygon *polygon, int flags, SrcPolygon *sp)
+//
+// true if the source polygon differs from the one of the last frame, which
+// then becomes the one of the last frame
+//
+bool MyGLWidget::SrcPolygonMoved(void)
 {
-    switch(flags){
-    case 0b0001:
-        PolygonAddVertex(polygon,sp->vertices[0].v0);
-        return;
-    case 0b0010:
-        PolygonAddVertex(polygon,sp->vertices[1].v0);
-        return;
-    case 0b0100:
-        PolygonAddVertex(polygon,sp->vertices[2].v0);
-        return;
-    case 0b1000:
-        PolygonAddVertex(polygon,sp->vertices[3].v0);
-        return;
+    bool moved = false;
+    for(int i=0;i<4;i++){
+        glm::vec2 v = engine.srcPolygon.vertices[i].v0;
+        if(v!=frame_vertices[i]){
+            frame_vertices[i] = v;
+            moved = true;
+        }
     }
+    return moved;
 }
 
-void MyGLWidget::PolygonAddMultiVFlag(Polygon *polygon, int vflag, SrcPolygon *sp){
-    switch(vflag){
-    case 0b0000:
-        return;
-    case 0b0011:
-        PolygonAddVertex(polygon,sp->vertices[0].v0);
-        PolygonAddVertex(polygon,sp->vertices[1].v0);
-        return;
-    case 0b0110:
-        PolygonAddVertex(polygon,sp->vertices[1].v0);
-        PolygonAddVertex(polygon,sp->vertices[2].v0);
-        return;
-    case 0b0111:
-        PolygonAddVertex(polygon,sp->vertices[0].v0);
-        PolygonAddVertex(polygon,sp->vertices[1].v0);
-        PolygonAddVertex(polygon,sp->vertices[2].v0);
-        return;
-    case 0b1001:
-        PolygonAddVertex(polygon,sp->vertices[3].v0);
-        PolygonAddVertex(polygon,sp->vertices[0].v0);
-        return;
-    case 0b1011:
-        PolygonAddVertex(polygon,sp->vertices[3].v0);
-        PolygonAddVertex(polygon,sp->vertices[0].v0);
-        PolygonAddVertex(polygon,sp->vertices[1].v0);
-        return;
-    case 0b1100:
-        PolygonAddVertex(polygon,sp->vertices[2].v0);
-        PolygonAddVertex(polygon,sp->vertices[3].v0);
-        return;
-    case 0b1101:
-        PolygonAddVertex(polygon,sp->vertices[2].v0);
-        PolygonAddVertex(polygon,sp->vertices[3].v0);
-        PolygonAddVertex(polygon,sp->vertices[0].v0);
-        return;
-    case 0b1110:
-        PolygonAddVertex(polygon,sp->vertices[1].v0);
-        PolygonAddVertex(polygon,sp->vertices[2].v0);
-        PolygonAddVertex(polygon,sp->vertices[3].v0);
+void MyGLWidget::SweepThread(void)
+{
+    // one core is left to the GUI and the geometry thread
+    int n_threads = glm::max(EmulateThreadCount(0) - 1,1);
+    EmulateTransformParallel(&sweepEngine,SWEEP_SIZE,SWEEP_SIZE,M_inv,n_threads,&sweep_progress);
+    if(sweep_progress.cancel){
+        qDebug("startup sweep cancelled after %d rows.\n",sweep_progress.rows_done.load());
         return;
     }
-}
-
-
-void MyGLWidget::PolygonAddEdgeForward(Polygon *polygon, PixelEdge *edge)
-{
-    switch(edge->code){
-    case 0:
-        if(edge->inside_ends[0]==0b1111){
-            PolygonAddVertex(polygon,edge->v_ends[0]);
+    if(!sweepEngine.fail_vector.empty()){
+        CorpusBuilder builder;
+        CorpusBuilderAddSweep(&builder,&sweepEngine,M_inv);
+        if(CorpusBuilderWrite(&builder,VIEWER_CORPUS)){
+            qDebug("%zu failures recorded in the corpus.\n",sweepEngine.fail_vector.size());
         }
-        break;
-    case 1:
-        PolygonAddVertex(polygon,edge->v_ends[0]);
-        PolygonAddVertex(polygon,edge->v_edge[1]);
-        break;
-    case 2:
-        PolygonAddVertex(polygon,edge->v_edge[0]);
-        break;
-    case 3:
-        PolygonAddVertex(polygon,edge->v_edge[0]);
-        PolygonAddVertex(polygon,edge->v_edge[1]);
-        break;
     }
 }
 
-void MyGLWidget::PolygonAddEdgeReverse(Polygon *polygon, PixelEdge *edge)
+void MyGLWidget::SweepFailures(void *user, const glm::vec2 *v2_src00, const float *, size_t n)
 {
-    switch(edge->code){
-    case 0:
-        if(edge->inside_ends[1]==0b1111){
-            PolygonAddVertex(polygon,edge->v_ends[1]);
-        }
-        break;
-    case 1:
-        PolygonAddVertex(polygon,edge->v_edge[1]);
-        break;
-    case 2:
-        PolygonAddVertex(polygon,edge->v_ends[1]);
-        PolygonAddVertex(polygon,edge->v_edge[0]);
-        break;
-    case 3:
-        PolygonAddVertex(polygon,edge->v_edge[1]);
-        PolygonAddVertex(polygon,edge->v_edge[0]);
-        break;
-    }
+    MyGLWidget *widget = (MyGLWidget*)user;
+    std::lock_guard<std::mutex> lock(widget->fail_mutex);
+    widget->sweep_fails.insert(widget->sweep_fails.end(),v2_src00,v2_src00 + n);
 }
 
-void MyGLWidget::PolygonAddEdgeSingleVertexForward(Polygon *polygon, PixelEdge *edge, int vflag, SrcPolygon *sp)
+void MyGLWidget::GeometryThread(void)
 {
-    switch(edge->code){
-    case 0:
-        if(edge->inside_ends[0]==0b1111){
-            PolygonAddVertex(polygon,edge->v_ends[0]);
-        }
-        break;
-    case 1:
-        PolygonAddVertex(polygon,edge->v_ends[0]);
-        PolygonAddVertex(polygon,edge->v_edge[1]);
-        break;
-    case 2:
-        vflag &= edge->vflag_edge[0];
-        if(vflag){
-            PolygonAddSingleVFlag(polygon, vflag, sp);
+    while(!stop_geometry){
+        bool animated = InitSrcPolygon();
+        if(SrcPolygonMoved()){
+            ViewerFrame *frame = new ViewerFrame;
+            engine.InitPixels();
+            BisectPixels(&frame->pixels);
+            InitSrcPolygonGeometry(&frame->srcPolygon);
+            InitGridGeometry(&frame->grid);
+            frame->grid_size = engine.grid_size;
+            delete latest_frame.exchange(frame);
         }
-        PolygonAddVertex(polygon,edge->v_edge[0]);
-        break;
-    case 3:
-        vflag &= edge->vflag_edge[0];
-        if(vflag){
-            PolygonAddSingleVFlag(polygon, vflag, sp);
+        std::unique_lock<std::mutex> lock(wake_mutex);
+        if(animated){
+            alpha += dalpha;
+            if(alpha>=1.0f)alpha-=1.0f;
+            wake.wait_for(lock,std::chrono::milliseconds(1000/60),
+                          [this]{ return stop_geometry.load(); });
+        }else{
+            // nothing moves until the space bar steps to the next failure
+            wake.wait(lock,[this]{ return stop_geometry || advance_i_fail; });
         }
-        PolygonAddVertex(polygon,edge->v_edge[0]);
-        PolygonAddVertex(polygon,edge->v_edge[1]);
-        break;
     }
 }
 
-void MyGLWidget::PolygonAddEdgeSingleVertexReverse(Polygon *polygon, PixelEdge *edge, int vflag, SrcPolygon *sp)
-{
-    switch(edge->code){
-    case 0:
-        if(edge->inside_ends[1]==0b1111){
-            PolygonAddVertex(polygon,edge->v_ends[1]);
-        }
-        break;
-    case 1:
-        vflag &= edge->vflag_edge[1];
-        if(vflag){
-            PolygonAddSingleVFlag(polygon, vflag, sp);
+void MyGLWidget::BisectPixels(BatchGeometry *pixels){
+    glm::vec2 origin = glm::vec2(engine.i2_v0);
+    GLfloat even_colors[3]={0.5f,0.5f,0.25f};
+    GLfloat odd_colors[3]={0.25f,0.25f,0.5f};
+    SrcPolygon *srcPolygon = &engine.srcPolygon;
+    if(engine.Npixelx==1 && engine.Npixely==1){
+        // source polygon is completely within pixel (0,0)
+        // draw the vertices of the source polygon
+        for(int i=0;i<4;i++){
+            BatchAddVertex(pixels,srcPolygon->vertices[i].v0 - origin,even_colors);
         }
-        PolygonAddVertex(polygon,edge->v_edge[1]);
-        break;
-    case 2:
-        PolygonAddVertex(polygon,edge->v_ends[1]);
-        PolygonAddVertex(polygon,edge->v_edge[0]);
-        break;
-    case 3:
-        vflag &= edge->vflag_edge[1];
-        if(vflag){
-            PolygonAddSingleVFlag(polygon, vflag, sp);
+        BatchAddFan(pixels,0,4);
+        return;
+    }
+    float src_area = SrcPolygonArea(srcPolygon);
+    float total_area = 0.0f;
+    Polygon *polygon = &engine.polygon;
+    for(int y=0;y<engine.Npixely;y++){
+        for(int x=0;x<engine.Npixelx;x++){
+            engine.BisectPixel(x,y);
+            //
+            // now add the pixel to the batch, in a checkerboard
+            //
+            const GLfloat *colors = ((x^y)&1) ? odd_colors : even_colors;
+            GLuint first = (GLuint)pixels->vertices.size();
+            for(int i=0;i<polygon->N;i++){
+                BatchAddVertex(pixels,polygon->v[i] - origin,colors);
+            }
+            BatchAddFan(pixels,first,polygon->N);
+            total_area += PolygonArea(polygon);
         }
-        PolygonAddVertex(polygon,edge->v_edge[1]);
-        PolygonAddVertex(polygon,edge->v_edge[0]);
-        break;
+    }
+    float area_error = (total_area - src_area)/src_area;
+    if(fabsf(area_error)>0.05f){
+        qDebug("area_error:%f",area_error);
+//        if(theta_file.openMode()==QIODevice::WriteOnly){
+//            theta_file.write((char*)&alpha,sizeof(alpha));
+//        }
     }
 }
 
@@ -1169,358 +701,57 @@ void MyGLWidget::DrawPolygons()
 }
 */
 
-void MyGLWidget::DrawSrcPolygon()
+void MyGLWidget::InitSrcPolygonGeometry(BatchGeometry *srcPolygon)
 {
-    glm::vec2 origin = pixelVertices[0][0].v;
+    glm::vec2 origin = glm::vec2(engine.i2_v0);
     glm::vec2 v[4];
     for(int i=0;i<4;i++){
-        v[i] = srcPolygon.vertices[i].v0 - origin;
+        v[i] = engine.srcPolygon.vertices[i].v0 - origin;
     }
-
-    glColor3f(1.0f,0.0f,0.0f);
-    glBegin(GL_LINES);
-    glVertex2f(v[0].x, v[0].y);
-    glVertex2f(v[1].x, v[1].y);
-    glEnd();
-
-    glColor3f(0.0f,1.0f,0.0f);
-    glBegin(GL_LINES);
-    glVertex2f(v[1].x, v[1].y);
-    glVertex2f(v[2].x, v[2].y);
-    glEnd();
-
-    glColor3f(0.0f,0.0f,1.0f);
-    glBegin(GL_LINES);
-    glVertex2f(v[2].x, v[2].y);
-    glVertex2f(v[3].x, v[3].y);
-    glEnd();
-
-    glColor3f(1.0f,1.0f,0.0f);
-    glBegin(GL_LINES);
-    glVertex2f(v[3].x, v[3].y);
-    glVertex2f(v[0].x, v[0].y);
-    glEnd();
-}
-
-void MyGLWidget::DrawPolygon()
-{
-    glm::vec2 origin = pixelVertices[0][0].v;
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glTranslatef(-origin.x,-origin.y,0.0f);
-
-    glBegin(GL_POLYGON);
-    for(int i=0;i<polygon.N;i++){
-        glm::vec2 v = polygon.v[i];
-        glVertex2f(v.x,v.y);
+    GLfloat colors[4][3] = {
+        {1.0f,0.0f,0.0f},
+        {0.0f,1.0f,0.0f},
+        {0.0f,0.0f,1.0f},
+        {1.0f,1.0f,0.0f}
+    };
+    for(int i=0;i<4;i++){
+        BatchAddLine(srcPolygon,v[i],v[(i+1)&3],colors[i]);
     }
-    glEnd();
-    glPopMatrix();
-
 }
 
-void MyGLWidget::DrawGrid(void){
-    glBegin(GL_LINES);
+void MyGLWidget::InitGridGeometry(BatchGeometry *grid){
+    GLfloat colors[3] = {0.25f,0.25f,0.25f};
+    int grid_size = engine.grid_size;
     float f_grid_size = (float)grid_size;
     for(int x=0;x<=grid_size;x++){
         float x_real = (float)x;
-        glVertex2f(x_real,0.0f);
-        glVertex2f(x_real,-f_grid_size);
+        BatchAddLine(grid,glm::vec2(x_real,0.0f),glm::vec2(x_real,-f_grid_size),colors);
     }
-    glEnd();
-    glBegin(GL_LINES);
     for(int y=0;y>=-grid_size;y--){
         float y_real = (float)y;
-        glVertex2f(0.0f, y_real);
-        glVertex2f(f_grid_size,y_real);
+        BatchAddLine(grid,glm::vec2(0.0f,y_real),glm::vec2(f_grid_size,y_real),colors);
     }
-    glEnd();
 }
 
 void MyGLWidget::timer_func()
 {
-    repaint(0,0,-1,-1);
-}
-
-void SrcPolygonInitVertices(SrcPolygon *sp, glm::vec2 *vertices, glm::mat3 &M)
-{
-    for(int v=0;v<4;v++){
-        glm::vec3 vw(vertices[v],1.0f);
-        glm::vec3 vwp = M*vw;
-        sp->vertices[v].v0 = glm::vec2(vwp);
-    }
-
-}
-
-void SrcPolygonInitEdges(SrcPolygon *sp)
-{
-    for(int i_v0=0;i_v0<4;i_v0++){
-        int i_v1 = i_v0 + 1;
-        if(i_v1==4)i_v1 = 0;
-        glm::vec2 v10 = sp->vertices[i_v1].v0 - sp->vertices[i_v0].v0;
-        sp->vertices[i_v0].v10 = v10;
-        sp->vertices[i_v0].N = glm::normalize(glm::vec2(-v10.y,v10.x));
-    }
-}
-
-int f2BisectSrcPolygon(SrcPolygon *sp, glm::vec2 v)
-{
-    int r=0;
-    int inside_bit = 1;
-    float f_test;
-    for(int e=0;e<4;e++,inside_bit<<=1){
-        glm::vec2 vv0 = v - sp->vertices[e].v0;
-        f_test = glm::dot(vv0,sp->vertices[e].N);
-        if(f_test > -1e-5f){
-            r|=inside_bit;
-        }
-    }
-    return r;
-}
-
-void PixelEdgeBisectSrcPolygon(PixelEdge *pe, SrcPolygon *sp)
-{
-    // test for all outside of any edge
-    if((~pe->inside_ends[0])&(~pe->inside_ends[1])&0b1111){
-        return;
-    }
-    // find the intersecting edges
-    int intersecting = pe->inside_ends[0]^pe->inside_ends[1];
-    int edge_bit = 1;
-    for(int e=0;e<4;e++,edge_bit<<=1){
-        if(!(edge_bit&intersecting)) continue;
-        switch(pe->code){
-        case 0:
-            if(edge_bit&pe->inside_ends[0]){
-                // v0 is inside
-                pe->code = 1;
-                pe->v_edge[1] = f2IntersectionDelta(pe->v_ends[0],pe->v_ends[1],sp->vertices[e].v0,sp->vertices[e].v10);
-                pe->inside_edge[1] = f2BisectSrcPolygon(sp,pe->v_edge[1]);
-                pe->vflag_edge[1] = edge_bit;
-            }else{
-                // v1 is inside
-                pe->code = 2;
-                pe->v_edge[0] = f2IntersectionDelta(pe->v_ends[0],pe->v_ends[1],sp->vertices[e].v0,sp->vertices[e].v10);
-                pe->inside_edge[0] = f2BisectSrcPolygon(sp,pe->v_edge[0]);
-                pe->vflag_edge[0] = edge_bit;
-            }
-            break;
-        case 1:
-            // test for all outside
-            if((~pe->inside_ends[0])&(~pe->inside_edge[1])&edge_bit){
-                pe->code = 0;
-                return;
-            }
-            // test for an intersection
-            if((pe->inside_ends[0]^pe->inside_edge[1])&edge_bit){
-                if(pe->inside_ends[0]&edge_bit){
-                    // v0 is inside
-                    pe->code = 1;
-                    pe->v_edge[1] = f2IntersectionDelta(pe->v_ends[0],pe->v_edge[1],sp->vertices[e].v0,sp->vertices[e].v10);
-                    pe->inside_edge[1] = f2BisectSrcPolygon(sp,pe->v_edge[1]);
-                    pe->vflag_edge[1] = edge_bit;
-                }else{
-                    // v_edge[1] is inside
-                    pe->code = 3;
-                    pe->v_edge[0] = f2IntersectionDelta(pe->v_ends[0],pe->v_edge[1],sp->vertices[e].v0,sp->vertices[e].v10);
-                    pe->inside_edge[0] = f2BisectSrcPolygon(sp,pe->v_edge[0]);
-                    pe->vflag_edge[0] = edge_bit;
-                }
-            }
-            break;
-        case 2:
-            // test for all outside
-            if((~pe->inside_ends[1])&(~pe->inside_edge[0])&edge_bit){
-                pe->code = 0;
-                return;
-            }
-            // test for intersection with this edge
-            if((pe->inside_ends[1]^pe->inside_edge[0])&edge_bit){
-                if(pe->inside_ends[1]&edge_bit){
-                    // v1 is inside
-                    pe->code = 2;
-                    pe->v_edge[0] = f2IntersectionDelta(pe->v_edge[0],pe->v_ends[1],sp->vertices[e].v0,sp->vertices[e].v10);
-                    pe->inside_edge[0] = f2BisectSrcPolygon(sp,pe->v_edge[0]);
-                    pe->vflag_edge[0] = edge_bit;
-                }else{
-                    // edge->v[0] is inside
-                    pe->code = 3;
-                    pe->v_edge[1] = f2IntersectionDelta(pe->v_edge[0],pe->v_ends[1],sp->vertices[e].v0,sp->vertices[e].v10);
-                    pe->inside_edge[1] = f2BisectSrcPolygon(sp,pe->v_edge[1]);
-                    pe->vflag_edge[1] = edge_bit;
-                }
-            }
-            break;
-        case 3:
-            // test for all outside
-            if((~pe->inside_edge[0])&(~pe->inside_edge[1])&0b1111){
-                pe->code = 0;
-                return;
-            }
-            // test for intersection with this edge
-            if((pe->inside_edge[0]^pe->inside_edge[1])&edge_bit){
-                if(pe->inside_edge[0]&edge_bit){
-                    pe->code = 3;
-                    pe->v_edge[1] = f2IntersectionDelta(pe->v_edge[0],pe->v_edge[1],sp->vertices[e].v0,sp->vertices[e].v10);
-                    pe->inside_edge[1] = f2BisectSrcPolygon(sp,pe->v_edge[1]);
-                    pe->vflag_edge[1] = edge_bit;
-                }else{
-                    pe->code = 3;
-                    pe->v_edge[0] = f2IntersectionDelta(pe->v_edge[0],pe->v_edge[1],sp->vertices[e].v0,sp->vertices[e].v10);
-                    pe->inside_edge[0] = f2BisectSrcPolygon(sp,pe->v_edge[0]);
-                    pe->vflag_edge[0] = edge_bit;
-                }
-            }
-            break;
-        }
-    }
-}
-
-void PixelEdgeBorderBisectSrcPolygon(PixelEdge *pe, SrcPolygon *sp)
-{
-    // the only case to bisect a border edge is when there is
-    // one intersection and the rest are all inside
-    int intersecting = pe->inside_ends[0]^pe->inside_ends[1];
-    int all_inside = pe->inside_ends[0]&pe->inside_ends[1];
-    switch(intersecting){
-    case 1:
-        if(all_inside==0b1110){
-            if(pe->inside_ends[0]&intersecting){
-                // v0 is inside
-                pe->code = 1;
-                pe->v_edge[1] = f2IntersectionDelta(pe->v_ends[0],pe->v_ends[1],sp->vertices[0].v0,sp->vertices[0].v10);
-                pe->vflag_edge[1] = 0b0001;
-            }else{
-                // v1 is inside
-                pe->code = 2;
-                pe->v_edge[0] = f2IntersectionDelta(pe->v_ends[0],pe->v_ends[1],sp->vertices[0].v0,sp->vertices[0].v10);
-                pe->vflag_edge[0] = 0b0001;
-            }
-        }
-        return;
-    case 2:
-        if(all_inside==0b1101){
-            if(pe->inside_ends[0]&intersecting){
-                // v0 is inside
-                pe->code = 1;
-                pe->v_edge[1] = f2IntersectionDelta(pe->v_ends[0],pe->v_ends[1],sp->vertices[1].v0,sp->vertices[1].v10);
-                pe->vflag_edge[1] = 0b0010;
-            }else{
-                // v1 is inside
-                pe->code = 2;
-                pe->v_edge[0] = f2IntersectionDelta(pe->v_ends[0],pe->v_ends[1],sp->vertices[1].v0,sp->vertices[1].v10);
-                pe->vflag_edge[0] = 0b0010;
-            }
-        }
-        return;
-    case 4:
-        if(all_inside==0b1011){
-            if(pe->inside_ends[0]&intersecting){
-                // v0 is inside
-                pe->code = 1;
-                pe->v_edge[1] = f2IntersectionDelta(pe->v_ends[0],pe->v_ends[1],sp->vertices[2].v0,sp->vertices[2].v10);
-                pe->vflag_edge[1] = 0b0100;
-            }else{
-                // v1 is inside
-                pe->code = 2;
-                pe->v_edge[0] = f2IntersectionDelta(pe->v_ends[0],pe->v_ends[1],sp->vertices[2].v0,sp->vertices[2].v10);
-                pe->vflag_edge[0] = 0b0100;
-            }
-        }
-        return;
-    case 8:
-        if(all_inside==0b0111){
-            if(pe->inside_ends[0]&intersecting){
-                // v0 is inside
-                pe->code = 1;
-                pe->v_edge[1] = f2IntersectionDelta(pe->v_ends[0],pe->v_ends[1],sp->vertices[3].v0,sp->vertices[3].v10);
-                pe->vflag_edge[1] = 0b1000;
-            }else{
-                // v1 is inside
-                pe->code = 2;
-                pe->v_edge[0] = f2IntersectionDelta(pe->v_ends[0],pe->v_ends[1],sp->vertices[3].v0,sp->vertices[3].v10);
-                pe->vflag_edge[0] = 0b1000;
-            }
+    //
+    // the progress of the startup sweep in the title, Escape cancels it
+    //
+    int rows = sweep_progress.rows_done;
+    if(sweep_thread.joinable() && rows!=title_rows){
+        size_t n_fail;
+        {
+            std::lock_guard<std::mutex> lock(fail_mutex);
+            n_fail = sweep_fails.size();
         }
-        return;
-    default:
-        return;
+        window()->setWindowTitle(QString::asprintf("startup sweep %d/%d rows, %zu failures",
+                                                   rows,SWEEP_SIZE,n_fail));
+        title_rows = rows;
     }
-}
-
-glm::vec2 f2IntersectionDelta(glm::vec2 a0, glm::vec2 a1, glm::vec2 b0, glm::vec2 b10)
-{
-    glm::vec2 d_a = a1-a0;
-    glm::vec2 r_a0b0;
-    bool swap_a;
-    float d_a_dot_d_b = glm::dot(d_a,b10);
-    if(d_a_dot_d_b<0.0f){
-        // swap a0 and a1 and start over
-        d_a *= -1.0f;
-        d_a_dot_d_b *= -1.0f;
-        r_a0b0 = a1 - b0;
-        swap_a = true;
-    }else{
-        r_a0b0 = a0 - b0;
-        swap_a = false;
+    // the widget is only repainted when there is a new frame to draw
+    if(latest_frame.load()){
+        update();
     }
-    float d_a_dot_d_a = glm::dot(d_a,d_a);
-    float d_b_dot_d_b = glm::dot(b10,b10);
-    float d_ab_dot_d_a = glm::dot(r_a0b0,d_a);
-    float d_ab_dot_d_b = glm::dot(r_a0b0,b10);
-    float t_num_p = d_a_dot_d_b*d_ab_dot_d_b;
-    float t_num_m = d_b_dot_d_b*d_ab_dot_d_a;
-    float t_det = d_a_dot_d_a*d_b_dot_d_b - d_a_dot_d_b*d_a_dot_d_b;
-    float t = (t_num_p - t_num_m) / t_det;
-    if(!isfinite(t)){
-        qDebug("infinite result t_det:%f",t_det);
-        t=0.5f;
-    }
-    if(t<0.0f)t=0.0f;
-    if(t>1.0f)t=1.0f;
-    if(swap_a){
-        return a1 + d_a*t;
-    }else{
-        return a0 + d_a*t;
-    }
-}
-
-glm::ivec2 convert_ivec2_plus(glm::vec2 v)
-{
-    glm::ivec2 r = v;
-    if(v.x<0.0f) r.x--;
-    if(v.y>0.0f) r.y++;
-    return r;
-}
-
-float f2cross(glm::vec2 &a, glm::vec2 &b)
-{
-    return a.x*b.y - a.y*b.x;
 }
 
-float SrcPolygonArea(SrcPolygon *sp)
-{
-    // since the source polygon is allways a paralellogram
-    // the area is just the cross product of two of the sides
-    return f2cross(sp->vertices[0].v10,sp->vertices[1].v10);
-}
-
-void PolygonAddVertex(Polygon *p, glm::vec2 &v)
-{
-    p->v[p->N] = v;
-    p->N++;
-}
-
-float PolygonArea(Polygon *p)
-{
-    if(p->N<3)return 0.0f;
-    int Ntri = p->N - 2;
-    glm::vec2 v0 = p->v[0];
-    float area = 0.0f;
-    for(int t=0;t<Ntri;t++){
-        glm::vec2 v10 = p->v[t+1] - v0;
-        glm::vec2 v21 = p->v[t+2] - p->v[t+1];
-        area += f2cross(v10,v21);
-    }
-    return area/2.0f;
-}
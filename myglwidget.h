@@ -6,84 +6,55 @@
 #include <QWidget>
 #include <QOpenGLFunctions>
 #include <QTimer>
-#include <QFile>
 #include <QKeyEvent>
 
-#define GLM_ENABLE_EXPERIMENTAL
-
-#include <glm/glm.hpp>
-#include <glm/gtx/matrix_transform_2d.hpp>
-#include <list>
-
-#define GRID_SIZE 32
+#include "bisectengine.h"
+#include "corpus.h"
+#include "emulate.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 //
-// vertex bits
+// the vertices, colours and indices of one kind of geometry
 //
-
-#define V0_BIT 0b0001
-#define V1_BIT 0b0010
-#define V2_BIT 0b0100
-#define V3_BIT 0b1000
-
-
-struct SrcVertex
-{
-    glm::vec2 v0;
-    glm::vec2 v10;
-    glm::vec2 N;
+struct BatchGeometry {
+    std::vector<glm::vec2> vertices;
+    std::vector<glm::vec3> colors;
+    std::vector<GLuint> indices;
 };
 
-struct SrcPolygon
-{
-    SrcVertex vertices[4];
-};
-
-void SrcPolygonInitVertices(SrcPolygon *sp, glm::vec2 *vertices, glm::mat3 &M);
-void SrcPolygonInitEdges(SrcPolygon *sp);
-float SrcPolygonArea(SrcPolygon *sp);
-
-struct PixelEdge {
-    int code; // the type of edge
-    glm::vec2 v_ends[2]; // the ends of the edge
-    int inside_ends[2];  // inside flags for the ends
-    glm::vec2 v_edge[2]; // vertices inside the edge
-    int inside_edge[2];  // inside flags for the vertices inside the edge
-    int vflag_edge[2];   // the vertex flags for the vertices inside the edge
-};
-
-struct PixelVertex {
-    glm::vec2 v; // the coordinate of the vertex
-    int inside;  // the inside flags for the vertex
+//
+// Geometry of one kind drawn with a single glDrawElements call, from
+// buffer objects that BatchUpload fills only when the geometry changes.
+//
+struct GLBatch {
+    GLenum mode;                       // GL_TRIANGLES or GL_LINES
+    GLuint buffers[3];                 // vertices, colors, indices
+    GLsizei n_indices;                 // uploaded indices
 };
 
-int f2BisectSrcPolygon(SrcPolygon *sp, glm::vec2 v);
-
-void PixelEdgeBisectSrcPolygon(PixelEdge *pe, SrcPolygon *sp);
-void PixelEdgeBorderBisectSrcPolygon(PixelEdge *pe, SrcPolygon *sp);
-
-glm::vec2 f2IntersectionDelta(glm::vec2 a0, glm::vec2 a1, glm::vec2 b0, glm::vec2 b10);
-
-glm::ivec2 convert_ivec2_plus(glm::vec2 v);
-
-glm::vec2 v2conform_axis(glm::vec2 v);
-
-float f2cross(glm::vec2 &a, glm::vec2 &b);
-
-struct Polygon {
-    int N;
-    glm::vec2 v[10];
+//
+// Everything drawn for one position of the source polygon. The geometry
+// thread builds a frame and never touches it again once it is published,
+// paintGL takes it, uploads it and deletes it.
+//
+struct ViewerFrame {
+    BatchGeometry pixels;
+    BatchGeometry grid;
+    BatchGeometry srcPolygon;
+    int grid_size;
 };
 
-void PolygonAddVertex(Polygon *p, glm::vec2 &v);
-float PolygonArea(Polygon *p);
-
 class MyGLWidget : public QOpenGLWidget, protected QOpenGLFunctions
 {
     Q_OBJECT
 
 public:
     MyGLWidget(QWidget *parent);
+    ~MyGLWidget();
 protected:
     void initializeGL() override;
     void resizeGL(int w, int h) override;
@@ -94,42 +65,60 @@ private:
     float dalpha;
     float theta;
     glm::mat3 M_inv;
-    glm::vec2 v2_dsrcx;
-    glm::vec2 v2_dsrcy;
     int i_fail;
-    bool advance_i_fail;
-    std::vector<glm::vec2> fail_vector;
+    std::atomic<bool> advance_i_fail;
     QTimer *timer;
-    QFile  theta_file;
-    bool theta_file_write;
-    bool theta_file_open;
-    SrcPolygon srcPolygon;
-    void InitSrcPolygon(void);
-    PixelVertex pixelVertices[GRID_SIZE+1][GRID_SIZE+1];
-    PixelEdge xEdges[GRID_SIZE+1][GRID_SIZE];
-    PixelEdge yEdges[GRID_SIZE][GRID_SIZE+1];
-    int  pixelVFlags[GRID_SIZE][GRID_SIZE];
-    Polygon polygon;
-    int Npixelx;
-    int Npixely;
-    int grid_size;
+    Corpus corpus;
+    bool corpus_open;
+    // owned by the geometry thread once it is started
+    BisectEngine engine;
+    //
+    // The startup sweep of the glitch transform runs on sweep_thread with
+    // its own engine. Its failures are appended to sweep_fails as the rows
+    // are finished, the space bar browses them while the sweep goes on.
+    //
+    std::thread sweep_thread;
+    BisectEngine sweepEngine;
+    EmulateProgress sweep_progress;
+    std::mutex fail_mutex;
+    std::vector<glm::vec2> sweep_fails;
+    int title_rows;                    // the rows shown in the window title
+    void SweepThread(void);
+    static void SweepFailures(void *user, const glm::vec2 *v2_src00, const float *area_errors,
+                              size_t n);
+    bool InitSrcPolygon(void);
     int width;
     int height;
-    void InitPixels(void);
-    //void BisectEdges(void);
-    void PolygonAddSingleVFlag(Polygon *polygon, int flags, SrcPolygon *sp);
-    void PolygonAddMultiVFlag(Polygon *polygon, int vflag, SrcPolygon *sp);
-    void PolygonAddEdgeForward(Polygon *polygon, PixelEdge *edge);
-    void PolygonAddEdgeReverse(Polygon *polygon, PixelEdge *edge);
-    void PolygonAddEdgeSingleVertexForward(Polygon *polygon, PixelEdge *edge, int vflag, SrcPolygon *sp);
-    void PolygonAddEdgeSingleVertexReverse(Polygon *polygon, PixelEdge *edge, int vflag, SrcPolygon *sp);
+    GLBatch pixelBatch;
+    GLBatch gridBatch;
+    GLBatch srcPolygonBatch;
+    // the grid the batches hold
+    int batch_grid_size;
+    void BatchInit(GLBatch *batch, GLenum mode);
+    void BatchUpload(GLBatch *batch, const BatchGeometry *geometry);
+    void BatchDraw(GLBatch *batch);
+    void BatchFree(GLBatch *batch);
+    //
+    // The geometry thread advances the animation, bisects the pixels when
+    // the source polygon moves and publishes the frame in latest_frame. The
+    // handoff is an atomic exchange of the pointer, a frame that is
+    // replaced before paintGL takes it is deleted by the thread.
+    //
+    std::thread geometry_thread;
+    std::atomic<ViewerFrame*> latest_frame;
+    std::atomic<bool> stop_geometry;
+    // only for sleeping between ticks, held while advance_i_fail is set so
+    // that a key press always wakes the thread
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+    // the source polygon of the last frame built
+    glm::vec2 frame_vertices[4];
+    void GeometryThread(void);
+    bool SrcPolygonMoved(void);
     //void DrawPolygons(void);
-    void BisectAndDrawPixels(void);
-    bool BisectAndVerifyPixels(void);
-    void EmulateTransform(int width, int height, glm::mat3 &M_inv);
-    void DrawSrcPolygon(void);
-    void DrawPolygon(void);
-    void DrawGrid(void);
+    void BisectPixels(BatchGeometry *pixels);
+    void InitSrcPolygonGeometry(BatchGeometry *srcPolygon);
+    void InitGridGeometry(BatchGeometry *grid);
 public slots:
     void timer_func(void);
 };